@@ -0,0 +1,89 @@
+#if !defined (ARENA_H)
+#define ARENA_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+// One block for a known number of same-sized allocations,
+// e.g. the nodes of a tree built in bulk with std::allocate_shared.
+// The block is freed when the last allocation is freed
+// and the builder has let go of the arena.
+// Allocations beyond the count fall back to operator new.
+
+class NodeArena
+{
+public:
+    static NodeArena * create(std::size_t count) { return new NodeArena(count); }
+    // The builder is done allocating
+    void release() { unref(); }
+
+    void * allocate(std::size_t bytes, std::size_t align)
+    {
+        if (!_block)
+        {
+            _size = (bytes + align - 1) / align * align;
+            _block = static_cast<char *>(::operator new(_size * _count));
+        }
+        if (bytes > _size || _used == _count)
+            return ::operator new(bytes);
+        _live.fetch_add(1, std::memory_order_relaxed);
+        return _block + _size * _used++;
+    }
+    void deallocate(void * p)
+    {
+        char * c = static_cast<char *>(p);
+        if (_block && c >= _block && c < _block + _size * _count)
+            unref();
+        else
+            ::operator delete(p);
+    }
+private:
+    explicit NodeArena(std::size_t count)
+        : _block(nullptr), _size(0), _count(count), _used(0), _live(1)
+    {}
+    ~NodeArena() { ::operator delete(_block); }
+    void unref()
+    {
+        if (_live.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    char *      _block;
+    std::size_t _size;  // of one slot
+    std::size_t _count; // of slots
+    std::size_t _used;
+    std::atomic<std::size_t> _live; // allocations, plus one for the builder
+};
+
+// Allocator handing out single objects from a NodeArena
+// Only the builder allocates; anyone may deallocate
+
+template<class T>
+struct ArenaAllocator
+{
+    using value_type = T;
+
+    explicit ArenaAllocator(NodeArena * arena) : _arena(arena) {}
+    template<class U>
+    ArenaAllocator(ArenaAllocator<U> const & other) : _arena(other._arena) {}
+
+    T * allocate(std::size_t n)
+    {
+        assert(n == 1);
+        return static_cast<T *>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T * p, std::size_t)
+    {
+        _arena->deallocate(p);
+    }
+    template<class U>
+    bool operator==(ArenaAllocator<U> const & other) const { return _arena == other._arena; }
+    template<class U>
+    bool operator!=(ArenaAllocator<U> const & other) const { return _arena != other._arena; }
+
+    NodeArena * _arena;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#if !defined (FLATIMAGE_H)
+#define FLATIMAGE_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Flat, position-independent image of a tree:
+// a header followed by an array of nodes
+// which refer to their children by index.
+// The image can be written to a file, mmap'ed,
+// and queried in place without deserialization.
+// A failed write and an image that doesn't check out
+// throw std::runtime_error, in release builds too.
+
+struct FlatHeader
+{
+    char          _magic[4];  // "RBF1"
+    std::uint32_t _nodeSize;  // guards against a mismatched node type
+    std::int32_t  _count;
+    std::int32_t  _root;      // -1 for an empty tree
+};
+
+// The node array starts at the first suitably aligned offset
+
+template<class Node>
+std::size_t flatNodeOffset()
+{
+    return (sizeof(FlatHeader) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+}
+
+inline void flatCheck(bool ok, char const * what)
+{
+    if (!ok)
+        throw std::runtime_error(std::string("Flat image: ") + what);
+}
+
+template<class Node>
+void writeFlatImage(std::vector<Node> const & nodes, std::int32_t root, std::ostream & os)
+{
+    FlatHeader header = { { 'R', 'B', 'F', '1' }
+                        , sizeof(Node)
+                        , static_cast<std::int32_t>(nodes.size())
+                        , root };
+    os.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    char const pad[alignof(Node)] = {};
+    os.write(pad, flatNodeOffset<Node>() - sizeof(header));
+    os.write(reinterpret_cast<char const *>(nodes.data()), nodes.size() * sizeof(Node));
+    flatCheck(os.good(), "write failed");
+}
+
+template<class Node>
+Node const * flatNodes(void const * image)
+{
+    return reinterpret_cast<Node const *>(static_cast<char const *>(image) + flatNodeOffset<Node>());
+}
+
+// Validate the image and return its header
+// Nodes are written in pre-order, so every child index is
+// past its parent's and below the count, or -1: lookups and thawing
+// stay inside the image and can't loop, whatever the file contains.
+// That's one pass over the nodes when the image is opened.
+template<class Node>
+FlatHeader const * flatHeader(void const * image, std::size_t bytes)
+{
+    flatCheck(image && bytes >= flatNodeOffset<Node>(), "shorter than its header");
+    FlatHeader const * header = static_cast<FlatHeader const *>(image);
+    flatCheck(std::memcmp(header->_magic, "RBF1", 4) == 0, "bad magic or version");
+    flatCheck(header->_nodeSize == sizeof(Node), "node size doesn't match");
+    flatCheck(header->_count >= 0 && header->_root >= -1 && header->_root < header->_count,
+        "bad node count or root");
+    flatCheck((bytes - flatNodeOffset<Node>()) / sizeof(Node) >= std::size_t(header->_count),
+        "nodes run past the end");
+    Node const * nodes = flatNodes<Node>(image);
+    for (std::int32_t i = 0; i < header->_count; ++i)
+    {
+        Node const & node = nodes[i];
+        flatCheck((node._lft == -1 || (node._lft > i && node._lft < header->_count))
+            && (node._rgt == -1 || (node._rgt > i && node._rgt < header->_count)),
+            "bad child index");
+    }
+    return header;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#if ! defined(FORCEONCE_H)
+#define FORCEONCE_H
+
+#include <atomic>
+#include <thread>
+
+// The state of a suspension that may be forced by many threads.
+// It's evaluated once, by whichever thread gets there first;
+// the others wait for it, then see everything it wrote.
+// Once forced, a test is a single acquire load.
+// If the evaluation throws, the next one to force tries again.
+
+class ForceOnce
+{
+    enum { unevaluated, evaluating, done };
+public:
+    explicit ForceOnce(bool forced = false) : _state(forced ? done : unevaluated) {}
+    ForceOnce(ForceOnce const &) = delete;
+    ForceOnce & operator=(ForceOnce const &) = delete;
+    bool isForced() const { return _state.load(std::memory_order_acquire) == done; }
+    template<class Eval>
+    void force(Eval eval) const
+    {
+        if (_state.load(std::memory_order_acquire) != done)
+            wait(eval);
+    }
+private:
+    template<class Eval>
+    void wait(Eval & eval) const
+    {
+        for (;;)
+        {
+            int state = unevaluated;
+            if (_state.compare_exchange_strong(state, evaluating, std::memory_order_acquire))
+            {
+                try
+                {
+                    eval();
+                }
+                catch (...)
+                {
+                    publish(unevaluated);
+                    throw;
+                }
+                publish(done);
+                return;
+            }
+            if (state == done)
+                return;
+#if defined(__cpp_lib_atomic_wait)
+            _state.wait(evaluating, std::memory_order_acquire);
+#else
+            std::this_thread::yield();
+#endif
+        }
+    }
+    void publish(int state) const
+    {
+        _state.store(state, std::memory_order_release);
+#if defined(__cpp_lib_atomic_wait)
+        _state.notify_all();
+#endif
+    }
+    std::atomic<int> mutable _state;
+};
+
+#endif
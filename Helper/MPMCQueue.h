@@ -0,0 +1,168 @@
+#if ! defined(MPMCQUEUE_H)
+#define MPMCQUEUE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded multi-producer multi-consumer queue (Vyukov)
+// A ring of cells, each with a sequence number that tells
+// whose turn it is: a producer at position pos waits for seq == pos,
+// a consumer for seq == pos + 1. Producers and consumers only
+// contend on their own position counter, with one CAS per operation,
+// or per batch.
+// No locks, no allocation after construction.
+// A thread that claimed a cell and was preempted before publishing it
+// holds back the threads that come to the same cell one lap later.
+
+template<class T>
+class MPMCQueue
+{
+    struct Cell
+    {
+        std::atomic<std::size_t> _seq;
+        T _v;
+    };
+    static const std::size_t cacheLine = 64;
+public:
+    // capacity must be a power of two
+    explicit MPMCQueue(std::size_t capacity)
+        : _cells(new Cell[capacity]), _mask(capacity - 1), _pushPos(0), _popPos(0)
+    {
+        assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+        for (std::size_t i = 0; i < capacity; ++i)
+            _cells[i]._seq.store(i, std::memory_order_relaxed);
+    }
+    MPMCQueue(MPMCQueue const &) = delete;
+    MPMCQueue & operator=(MPMCQueue const &) = delete;
+
+    std::size_t capacity() const { return _mask + 1; }
+
+    // False when full
+    bool tryPush(T x)
+    {
+        std::size_t pos = _pushPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell & cell = _cells[pos & _mask];
+            std::size_t seq = cell._seq.load(std::memory_order_acquire);
+            std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+            if (dif == 0)
+            {
+                if (_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell._v = std::move(x);
+                    cell._seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = _pushPos.load(std::memory_order_relaxed);
+        }
+    }
+    // False when empty
+    bool tryPop(T & x)
+    {
+        std::size_t pos = _popPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell & cell = _cells[pos & _mask];
+            std::size_t seq = cell._seq.load(std::memory_order_acquire);
+            std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+            if (dif == 0)
+            {
+                if (_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    x = std::move(cell._v);
+                    cell._seq.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = _popPos.load(std::memory_order_relaxed);
+        }
+    }
+    // Pushes up to n elements starting at b; returns how many.
+    // The free cells are counted first, then claimed with a single CAS:
+    // once claimed, nobody else can touch them.
+    template<class Iter>
+    std::size_t tryPushBatch(Iter b, std::size_t n)
+    {
+        if (n == 0)
+            return 0;
+        std::size_t pos = _pushPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            std::size_t k = 0;
+            while (k < n && k <= _mask
+                && _cells[(pos + k) & _mask]._seq.load(std::memory_order_acquire) == pos + k)
+                ++k;
+            if (k == 0)
+            {
+                std::size_t seq = _cells[pos & _mask]._seq.load(std::memory_order_acquire);
+                if ((std::ptrdiff_t)seq - (std::ptrdiff_t)pos < 0)
+                    return 0; // full
+                pos = _pushPos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (_pushPos.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+            {
+                for (std::size_t i = 0; i < k; ++i, ++b)
+                {
+                    Cell & cell = _cells[(pos + i) & _mask];
+                    cell._v = *b;
+                    cell._seq.store(pos + i + 1, std::memory_order_release);
+                }
+                return k;
+            }
+        }
+    }
+    // Pops up to n elements into out; returns how many
+    template<class Out>
+    std::size_t tryPopBatch(Out out, std::size_t n)
+    {
+        if (n == 0)
+            return 0;
+        std::size_t pos = _popPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            std::size_t k = 0;
+            while (k < n && k <= _mask
+                && _cells[(pos + k) & _mask]._seq.load(std::memory_order_acquire) == pos + k + 1)
+                ++k;
+            if (k == 0)
+            {
+                std::size_t seq = _cells[pos & _mask]._seq.load(std::memory_order_acquire);
+                if ((std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1) < 0)
+                    return 0; // empty
+                pos = _popPos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (_popPos.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+            {
+                for (std::size_t i = 0; i < k; ++i, ++out)
+                {
+                    Cell & cell = _cells[(pos + i) & _mask];
+                    *out = std::move(cell._v);
+                    cell._seq.store(pos + i + _mask + 1, std::memory_order_release);
+                }
+                return k;
+            }
+        }
+    }
+private:
+    std::unique_ptr<Cell[]> _cells;
+    std::size_t _mask;
+    // each counter on its own cache line
+    alignas(cacheLine) std::atomic<std::size_t> _pushPos;
+    alignas(cacheLine) std::atomic<std::size_t> _popPos;
+    char _pad[cacheLine - sizeof(std::atomic<std::size_t>)];
+};
+
+#endif
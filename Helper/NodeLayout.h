@@ -0,0 +1,161 @@
+#if !defined (NODELAYOUT_H)
+#define NODELAYOUT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Node layouts for persistent red-black trees
+// A Node derives from Layout::Links<Node>, which holds
+// the color and the two children, and adds its payload:
+//
+// struct Node : Layout::template Links<Node> { T _val; };
+//
+// Links<Node> provides:
+//   Ptr                   -- owning pointer to a const Node
+//   isRed()
+//   left(), right()       -- raw pointers, for traversal
+//   leftPtr(), rightPtr() -- owning pointers, for sharing
+// Layout provides:
+//   make<Node>(args...)   -- allocates a node, returns Ptr
+//   nodeBytes<Node>()     -- memory taken by one node
+
+// Default: std::shared_ptr children, separate color field
+
+struct SharedNodes
+{
+    template<class Node>
+    struct Links
+    {
+        using Ptr = std::shared_ptr<const Node>;
+
+        Links(bool red, Ptr const & lft, Ptr const & rgt)
+            : _red(red), _lft(lft), _rgt(rgt)
+        {}
+        bool isRed() const { return _red; }
+        Node const * left() const { return _lft.get(); }
+        Node const * right() const { return _rgt.get(); }
+        Ptr leftPtr() const { return _lft; }
+        Ptr rightPtr() const { return _rgt; }
+    private:
+        bool _red;
+        Ptr _lft;
+        Ptr _rgt;
+    };
+    template<class Node, class... Args>
+    static std::shared_ptr<const Node> make(Args &&... args)
+    {
+        return std::make_shared<const Node>(std::forward<Args>(args)...);
+    }
+    // Approximate: make_shared puts the node next to
+    // a control block with a vtable pointer and two counts
+    template<class Node>
+    static std::size_t nodeBytes()
+    {
+        return sizeof(Node) + sizeof(void *) + 2 * sizeof(int);
+    }
+};
+
+// Intrusively ref-counted pointer
+// T must have a mutable std::atomic<unsigned> _refs
+
+template<class T>
+class IntrusivePtr
+{
+public:
+    IntrusivePtr() : _p(nullptr) {}
+    explicit IntrusivePtr(T * p) : _p(p) { acquire(); }
+    IntrusivePtr(IntrusivePtr const & other) : _p(other._p) { acquire(); }
+    IntrusivePtr(IntrusivePtr && other) : _p(other._p) { other._p = nullptr; }
+    ~IntrusivePtr() { release(); }
+    IntrusivePtr & operator=(IntrusivePtr other)
+    {
+        std::swap(_p, other._p);
+        return *this;
+    }
+    T * get() const { return _p; }
+    T * operator->() const { return _p; }
+    T & operator*() const { return *_p; }
+    explicit operator bool() const { return _p != nullptr; }
+    bool operator!() const { return _p == nullptr; }
+    bool operator==(IntrusivePtr const & other) const { return _p == other._p; }
+    bool operator!=(IntrusivePtr const & other) const { return _p != other._p; }
+    // Give up ownership without decrementing the count
+    T * detach()
+    {
+        T * p = _p;
+        _p = nullptr;
+        return p;
+    }
+private:
+    void acquire()
+    {
+        if (_p)
+            _p->_refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    void release()
+    {
+        if (_p && _p->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete _p;
+    }
+    T * _p;
+};
+
+// Compact: intrusive ref count, color stored in the low bit
+// of the left child pointer (nodes are at least 4-byte aligned)
+// Node<int> takes 24 bytes and one allocation
+
+struct CompactNodes
+{
+    template<class Node>
+    struct Links
+    {
+        using Ptr = IntrusivePtr<const Node>;
+
+        Links(bool red, Ptr lft, Ptr rgt)
+            : _lft(reinterpret_cast<std::uintptr_t>(lft.detach()) | (red ? 1 : 0))
+            , _rgt(rgt.detach())
+            , _refs(0)
+        {}
+        Links(Links const &) = delete;
+        Links & operator=(Links const &) = delete;
+        ~Links()
+        {
+            release(left());
+            release(_rgt);
+        }
+        bool isRed() const { return (_lft & 1) != 0; }
+        Node const * left() const
+        {
+            return reinterpret_cast<Node const *>(_lft & ~std::uintptr_t(1));
+        }
+        Node const * right() const { return _rgt; }
+        Ptr leftPtr() const { return Ptr(left()); }
+        Ptr rightPtr() const { return Ptr(_rgt); }
+    private:
+        static void release(Node const * p)
+        {
+            if (p && p->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete p;
+        }
+        std::uintptr_t _lft; // tagged with color
+        Node const * _rgt;
+    public:
+        // last, so that the payload can fill the tail padding
+        mutable std::atomic<unsigned> _refs;
+    };
+    template<class Node, class... Args>
+    static IntrusivePtr<const Node> make(Args &&... args)
+    {
+        static_assert(alignof(Node) > 1, "color bit needs aligned nodes");
+        return IntrusivePtr<const Node>(new Node(std::forward<Args>(args)...));
+    }
+    template<class Node>
+    static std::size_t nodeBytes()
+    {
+        return sizeof(Node);
+    }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#if ! defined(QUEUEITER_H)
+#define QUEUEITER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Shared by the lazy queues (LazyQueue, PureStream): both keep
+// a front stream, oldest first, and a rear stream, newest first.
+// S is the stream type: it needs get(), popped_front() and a default
+// constructor for the empty stream.
+
+// The first n values of the rear, oldest first, appended to v.
+// No default-constructed elements: push newest first, then reverse.
+template<class T, class S>
+void appendRear(std::vector<T> & v, S rear, int n)
+{
+    auto b = v.size();
+    for (; n > 0; --n, rear = rear.popped_front())
+        v.push_back(rear.get());
+    std::reverse(v.begin() + b, v.end());
+}
+
+// A snapshot, front to back, in one allocation
+template<class T, class S>
+std::vector<T> queueToVector(S front, int lenF, S rear, int lenR)
+{
+    std::vector<T> v;
+    v.reserve(lenF + lenR);
+    for (int i = 0; i < lenF; ++i, front = front.popped_front())
+        v.push_back(front.get());
+    appendRear(v, std::move(rear), lenR);
+    return v;
+}
+
+// Walks the front stream, then a snapshot of the rear,
+// taken (oldest first) when the front runs out;
+// nothing is stored back in the queue
+// Elements are returned by value: reference is T.
+template<class T, class S>
+class QueueIter
+{
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T const * pointer;
+    typedef T reference;
+
+    QueueIter() : _leftF(0), _left(0), _i(0) {} // end
+    // Doesn't assume lenR <= lenF
+    QueueIter(S front, int lenF, S rear, int lenR)
+        : _front(std::move(front)), _leftF(lenF), _rearS(std::move(rear)), _left(lenF + lenR), _i(0)
+    {
+        if (_leftF == 0 && _left > 0)
+            snapRear();
+    }
+    T operator*() const
+    {
+        return _leftF > 0 ? _front.get() : (*_rear)[_i];
+    }
+    QueueIter & operator++()
+    {
+        --_left;
+        if (_leftF > 0)
+        {
+            _front = _front.popped_front();
+            if (--_leftF == 0 && _left > 0)
+                snapRear();
+        }
+        else
+            ++_i;
+        return *this;
+    }
+    bool operator==(QueueIter const & other) const
+    {
+        return _left == other._left;
+    }
+    bool operator!=(QueueIter const & other) const
+    {
+        return !(*this == other);
+    }
+private:
+    void snapRear()
+    {
+        auto v = std::make_shared<std::vector<T>>();
+        v->reserve(_left);
+        appendRear(*v, std::move(_rearS), _left);
+        _rear = v;
+        _rearS = S();
+    }
+    S _front;
+    int _leftF;
+    S _rearS;
+    std::shared_ptr<const std::vector<T>> _rear;
+    int _left;
+    int _i;
+};
+
+#endif
@@ -34,11 +34,13 @@ public:
     List<Pos> getSolution() const { return _queens; }
 
     bool isFinished(int dim) const { return _curRow == dim; }
-    Stream<PartSol> refine(int dim) const;
+    template<class P = SingleThreaded>
+    Stream<PartSol, P> refine(int dim) const;
 
     friend std::ostream& operator<<(std::ostream& os, PartSol const & p);
 private:
-    Stream<PartSol> refineRow(int col, int dim) const;
+    template<class P>
+    Stream<PartSol, P> refineRow(int col, int dim) const;
     bool isAllowed(Pos const & pos) const;
 
     int       _curRow;
@@ -66,23 +68,28 @@ bool PartSol::isAllowed(Pos const & pos) const
     return true;
 }
 
-Stream<PartSol> PartSol::refineRow(int col, int dim) const
+// The stream keeps a copy of the partial solution,
+// it may outlive this one, or be forced on another thread
+template<class P>
+Stream<PartSol, P> PartSol::refineRow(int col, int dim) const
 {
     while (col < dim && !isAllowed(Pos(col, _curRow)))
         ++col;
     if (col == dim)
-        return Stream<PartSol>();
-    return Stream<PartSol>([this, col, dim]() -> Cell<PartSol>
+        return Stream<PartSol, P>();
+    PartSol self = *this;
+    return Stream<PartSol, P>([self, col, dim]() -> Cell<PartSol, P>
     {
-        PartSol part(_curRow + 1, _queens.pushed_front(Pos(col, _curRow)));
-        Stream<PartSol> tail = refineRow(col + 1, dim);
-        return Cell<PartSol>(part, tail);
+        PartSol part(self._curRow + 1, self._queens.pushed_front(Pos(col, self._curRow)));
+        Stream<PartSol, P> tail = self.refineRow<P>(col + 1, dim);
+        return Cell<PartSol, P>(part, tail);
     });
 }
 
-Stream<PartSol> PartSol::refine(int dim) const
+template<class P>
+Stream<PartSol, P> PartSol::refine(int dim) const
 {
-    return refineRow(0, dim);
+    return refineRow<P>(0, dim);
 }
 
 
@@ -141,6 +148,42 @@ std::vector<typename Partial::SolutionT> generatePar(int depth, Partial const &
     }
 }
 
+// The workers share the stream of refinements of part, each taking
+// every workers-th one: a cell is forced by whichever worker
+// gets to it first, so the stream has to be ThreadSafe
+template<class Partial, class Constraint>
+std::vector<typename Partial::SolutionT> generateShared(Partial const & part, Constraint constr, int workers)
+{
+    using SolutionVec = std::vector<typename Partial::SolutionT>;
+
+    if (part.isFinished(constr))
+    {
+        SolutionVec result{ part.getSolution() };
+        return result;
+    }
+    Stream<Partial, ThreadSafe> partStream = part.template refine<ThreadSafe>(constr);
+    std::vector<std::future<SolutionVec>> futResult;
+    for (int w = 0; w < workers; ++w)
+    {
+        futResult.push_back(std::async(std::launch::async, [partStream, constr, w, workers]()
+        {
+            SolutionVec result;
+            int i = 0;
+            forEach(partStream, [&](Partial const & part)
+            {
+                if (i++ % workers == w)
+                {
+                    SolutionVec lst = generate(part, constr);
+                    std::copy(lst.begin(), lst.end(), std::back_inserter(result));
+                }
+            });
+            return result;
+        }));
+    }
+    std::vector<SolutionVec> all = when_all_vec(futResult);
+    return concatAll(std::move(all));
+}
+
 void main()
 {
     std::vector<List<Pos>> sol = generatePar(3, PartSol(), 4);
@@ -149,4 +192,10 @@ void main()
     {
         std::cout << queens << std::endl;
     });
+    for (int dim = 1; dim <= 8; ++dim)
+    {
+        std::size_t shared = generateShared(PartSol(), dim, 3).size();
+        std::cout << dim << " queens: " << shared << " solutions"
+            << (shared == generate(PartSol(), dim).size() ? "" : ", Error: the shared stream differs") << std::endl;
+    }
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "LazyStream.h"
+#include "../Helper/QueueIter.h"
+#include <vector>
 
 template<class T>
 class Queue
@@ -19,6 +21,15 @@ public:
     {
         return check(_lenF - 1, _front.popped_front(), _lenR, _rear);
     }
+    int size() const { return _lenF + _lenR; }
+    // Front to back, without rotating the rear into the front
+    QueueIter<T, Stream<T>> begin() const { return QueueIter<T, Stream<T>>(_front, _lenF, _rear, _lenR); }
+    QueueIter<T, Stream<T>> end() const { return QueueIter<T, Stream<T>>(); }
+    // A snapshot, front to back, in one allocation
+    std::vector<T> toVector() const
+    {
+        return queueToVector<T>(_front, _lenF, _rear, _lenR);
+    }
     // for debugging only
     int lenF() const { return _lenF; }
     int lenR() const { return _lenR; }
@@ -35,4 +46,4 @@ private:
     Stream<T> _front;
     int _lenR;
     Stream<T> _rear;
-};
\ No newline at end of file
+};
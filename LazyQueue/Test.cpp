@@ -45,4 +45,15 @@ void main()
     std::cout << "Tail\n";
     auto t1 = q3.popped_front();
     printQ(t1);
+    auto t2 = t1.pushed_back(40).pushed_back(50);
+    printQ(t2);
+    std::cout << "Size " << t2.size() << ": ";
+    for (int x : t2)
+        std::cout << x << " ";
+    std::cout << std::endl;
+    // iterating forces the cells it reads, front and rear,
+    // but the queue keeps its split: nothing is rotated
+    printQ(t2);
+    std::vector<int> v = t2.toVector();
+    std::cout << "Snapshot: " << v.size() << " " << v.front() << " .. " << v.back() << std::endl;
 }
\ No newline at end of file
@@ -1,8 +1,9 @@
 #include <cassert>
 #include <functional>
 #include <memory>
-#include <mutex>
+#include "../Helper/ForceOnce.h"
 
+// Forced once, by whichever thread gets there first (see ForceOnce.h)
 template<class T>
 class Susp
 {
@@ -12,22 +13,22 @@ public:
     {}
     T const & force() const
     {
-        // There probably is a better, lock-free, 
-        // implememntation of this singleton
-        std::lock_guard<std::mutex> lck(_mtx);
-        if (!_memo)
+        _state.force([this]
+        {
             _memo = _f();
+            // release whatever the closure captured
+            _f = nullptr;
+        });
         return *_memo;
     }
-    bool isForced() const 
+    bool isForced() const
     {
-        std::lock_guard<std::mutex> lck(_mtx);
-        return !!_memo;
+        return _state.isForced();
     }
 private:
     std::unique_ptr<T> mutable _memo;
-    std::function<std::unique_ptr<T>()> _f;
-    std::mutex mutable _mtx;
+    std::function<std::unique_ptr<T>()> mutable _f;
+    ForceOnce _state;
 };
 
 template<class T>
@@ -1,5 +1,9 @@
 #include "LazyStream.h"
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
 
 Stream<int> mkStream(int a, int b)
 {
@@ -45,6 +49,62 @@ void lazyPrint(Stream<T> const & s)
     }
 }
 
+// Lazy a, a+1, ..., b-1
+Stream<int> range(int a, int b)
+{
+    if (a == b)
+        return Stream<int>();
+    return Stream<int>([=]()
+    {
+        return std::unique_ptr<const Cell<int>>(new Cell<int>(a, range(a + 1, b)));
+    });
+}
+
+long long sumAll(Stream<int> s)
+{
+    long long sum = 0;
+    for (; !s.isEmpty(); s = s.popped_front())
+        sum += s.get();
+    return sum;
+}
+
+// A forced cell doesn't keep what its closure captured
+void testRelease()
+{
+    auto captured = std::make_shared<int>(7);
+    Stream<int> s([captured]()
+    {
+        return std::unique_ptr<const Cell<int>>(new Cell<int>(*captured, Stream<int>()));
+    });
+    long before = captured.use_count();
+    int v = s.get();
+    std::cout << "Captured by the closure: " << before << " -> " << captured.use_count()
+        << (v == 7 && before == 2 && captured.use_count() == 1 ? " OK" : " Error") << std::endl;
+}
+
+// k threads walk the same stream: the first pass races to force
+// the cells, the second only reads the memos
+void benchShared(int n, int k)
+{
+    Stream<int> s = range(0, n);
+    std::atomic<long long> total(0);
+    double ms[2];
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < k; ++i)
+            threads.emplace_back([&s, &total]() { total += sumAll(s); });
+        for (std::thread & t : threads)
+            t.join();
+        ms[pass] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (total != 2LL * k * n * (n - 1) / 2)
+        std::cout << "Error: threads saw different streams\n";
+    std::cout << k << " threads, " << n << " cells. Forcing: " << ms[0]
+        << " ms, forced: " << ms[1] << " ms" << std::endl;
+}
+
 void main()
 {
     auto s1 = mkStream(5, 10);
@@ -85,4 +145,22 @@ void main()
 
     std::cout << "Force: \n";
     forcePrint(s);
-}
\ No newline at end of file
+
+    testRelease();
+    for (int k = 1; k <= 8; k *= 2)
+        benchShared(20000, k);
+}
+/* Release build (-O2 -DNDEBUG), single core machine
+   Before, with a mutex in force:
+1 threads, 20000 cells. Forcing: 5.11655 ms, forced: 1.07723 ms
+2 threads, 20000 cells. Forcing: 4.38728 ms, forced: 2.18305 ms
+4 threads, 20000 cells. Forcing: 6.31513 ms, forced: 4.09138 ms
+8 threads, 20000 cells. Forcing: 10.7332 ms, forced: 8.43849 ms
+   With the atomic state:
+1 threads, 20000 cells. Forcing: 5.75351 ms, forced: 0.675935 ms
+2 threads, 20000 cells. Forcing: 3.62315 ms, forced: 0.898556 ms
+4 threads, 20000 cells. Forcing: 4.25287 ms, forced: 1.61232 ms
+8 threads, 20000 cells. Forcing: 6.28742 ms, forced: 3.81251 ms
+   What's left of a forced pass is mostly the reference counts
+   of the shared_ptrs copied on the way.
+*/
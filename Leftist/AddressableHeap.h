@@ -0,0 +1,181 @@
+#if ! defined(ADDRESSABLEHEAP_H)
+#define ADDRESSABLEHEAP_H
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+// Ephemeral pairing heap whose elements can be reached
+// through the handles returned by push, e.g. to lower
+// the distance of a vertex in Dijkstra's algorithm
+// instead of pushing it again.
+// push, front: O(1)
+// decrease: O(1) to cut the subtree and link it back,
+// at most O(log n) amortized (the known bounds for pairing
+// heaps are o(log n), not O(1))
+// pop, erase: O(log n) amortized
+// A handle stays valid until its element is popped or erased.
+
+template<class T>
+class AddressableHeap
+{
+    struct Node
+    {
+        explicit Node(T v) : _v(std::move(v)), _kid(nullptr), _next(nullptr), _prev(nullptr) {}
+        T _v;
+        Node * _kid;
+        Node * _next;
+        Node * _prev; // parent of a first child, otherwise previous sibling
+    };
+public:
+    class Handle
+    {
+    public:
+        Handle() : _node(nullptr) {}
+        T const & value() const { return _node->_v; }
+        bool operator==(Handle const & other) const { return _node == other._node; }
+        bool operator!=(Handle const & other) const { return _node != other._node; }
+    private:
+        explicit Handle(Node * node) : _node(node) {}
+        friend class AddressableHeap;
+        Node * _node;
+    };
+
+    AddressableHeap() : _root(nullptr), _size(0) {}
+    AddressableHeap(AddressableHeap const &) = delete;
+    AddressableHeap & operator=(AddressableHeap const &) = delete;
+    AddressableHeap(AddressableHeap && other)
+        : _root(other._root), _size(other._size)
+    {
+        other._root = nullptr;
+        other._size = 0;
+    }
+    AddressableHeap & operator=(AddressableHeap && other)
+    {
+        std::swap(_root, other._root);
+        std::swap(_size, other._size);
+        return *this;
+    }
+    ~AddressableHeap()
+    {
+        // no recursion: sibling lists can be as long as the heap
+        std::vector<Node *> todo;
+        if (_root)
+            todo.push_back(_root);
+        while (!todo.empty())
+        {
+            Node * n = todo.back();
+            todo.pop_back();
+            if (n->_kid)
+                todo.push_back(n->_kid);
+            if (n->_next)
+                todo.push_back(n->_next);
+            delete n;
+        }
+    }
+
+    bool isEmpty() const { return _root == nullptr; }
+    int size() const { return _size; }
+    T const & front() const
+    {
+        assert(!isEmpty());
+        return _root->_v;
+    }
+    Handle push(T x)
+    {
+        Node * n = new Node(std::move(x));
+        _root = _root ? link(_root, n) : n;
+        ++_size;
+        return Handle(n);
+    }
+    void pop()
+    {
+        assert(!isEmpty());
+        Node * old = _root;
+        _root = mergePairs(old->_kid);
+        delete old;
+        --_size;
+    }
+    // x must not be greater than the current value
+    void decrease(Handle h, T x)
+    {
+        Node * n = h._node;
+        assert(x <= n->_v);
+        n->_v = std::move(x);
+        if (n != _root)
+        {
+            detach(n);
+            _root = link(_root, n);
+        }
+    }
+    void erase(Handle h)
+    {
+        Node * n = h._node;
+        if (n == _root)
+        {
+            pop();
+            return;
+        }
+        detach(n);
+        if (Node * kids = mergePairs(n->_kid))
+            _root = link(_root, kids);
+        delete n;
+        --_size;
+    }
+private:
+    // Both are roots (no siblings): the larger becomes
+    // the first child of the smaller
+    static Node * link(Node * a, Node * b)
+    {
+        if (b->_v < a->_v)
+            std::swap(a, b);
+        b->_next = a->_kid;
+        if (a->_kid)
+            a->_kid->_prev = b;
+        b->_prev = a;
+        a->_kid = b;
+        return a;
+    }
+    // Cuts the subtree at n out of its parent's list of children
+    static void detach(Node * n)
+    {
+        if (n->_prev->_kid == n)
+            n->_prev->_kid = n->_next;
+        else
+            n->_prev->_next = n->_next;
+        if (n->_next)
+            n->_next->_prev = n->_prev;
+        n->_next = nullptr;
+        n->_prev = nullptr;
+    }
+    // Merges a list of siblings: left to right in pairs, then right to left
+    Node * mergePairs(Node * first)
+    {
+        _pairs.clear();
+        while (first)
+        {
+            Node * a = first;
+            Node * b = a->_next;
+            first = b ? b->_next : nullptr;
+            a->_next = a->_prev = nullptr;
+            if (b)
+            {
+                b->_next = b->_prev = nullptr;
+                a = link(a, b);
+            }
+            _pairs.push_back(a);
+        }
+        if (_pairs.empty())
+            return nullptr;
+        Node * acc = _pairs.back();
+        for (std::size_t i = _pairs.size() - 1; i-- > 0; )
+            acc = link(_pairs[i], acc);
+        return acc;
+    }
+
+    Node * _root;
+    int _size;
+    std::vector<Node *> _pairs; // scratch for mergePairs
+};
+
+#endif
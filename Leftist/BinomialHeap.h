@@ -0,0 +1,110 @@
+#if ! defined(BINOMIALHEAP_H)
+#define BINOMIALHEAP_H
+
+#include "../List/List.h"
+#include <cassert>
+#include <memory>
+#include <utility>
+
+// Persistent binomial heap (Okasaki, 3.2)
+// A list of binomial trees in increasing order of rank,
+// at most one of each rank, like the binary digits of the size
+// inserted: O(1) amortized, O(log n) worst case
+// merged, popped_front, front: O(log n)
+
+template<class T>
+class BinomialHeap
+{
+    struct Tree;
+    using TreePtr = std::shared_ptr<const Tree>;
+    struct Tree
+    {
+        Tree(int rank, T v, List<TreePtr> const & kids)
+            : _rank(rank), _v(v), _kids(kids)
+        {}
+        int _rank;
+        T   _v;
+        List<TreePtr> _kids; // decreasing rank
+    };
+    explicit BinomialHeap(List<TreePtr> const & trees) : _trees(trees) {}
+public:
+    BinomialHeap() {}
+    explicit BinomialHeap(T x) : _trees(singleton(x)) {}
+    bool isEmpty() const { return _trees.isEmpty(); }
+    T front() const
+    {
+        assert(!isEmpty());
+        T x = _trees.front()->_v;
+        _trees.forEach([&x](TreePtr const & t)
+        {
+            if (t->_v < x)
+                x = t->_v;
+        });
+        return x;
+    }
+    BinomialHeap popped_front() const
+    {
+        assert(!isEmpty());
+        auto minRest = removeMinTree(_trees);
+        return BinomialHeap(mergeTrees(reversed(minRest.first->_kids), minRest.second));
+    }
+    BinomialHeap inserted(T x) const
+    {
+        return BinomialHeap(insTree(singleton(x), _trees));
+    }
+    static BinomialHeap merged(BinomialHeap const & h1, BinomialHeap const & h2)
+    {
+        return BinomialHeap(mergeTrees(h1._trees, h2._trees));
+    }
+private:
+    static TreePtr singleton(T x)
+    {
+        return std::make_shared<const Tree>(0, x, List<TreePtr>());
+    }
+    // Two trees of rank r make a tree of rank r + 1
+    static TreePtr link(TreePtr const & t1, TreePtr const & t2)
+    {
+        assert(t1->_rank == t2->_rank);
+        if (t1->_v <= t2->_v)
+            return std::make_shared<const Tree>(t1->_rank + 1, t1->_v, t1->_kids.pushed_front(t2));
+        else
+            return std::make_shared<const Tree>(t2->_rank + 1, t2->_v, t2->_kids.pushed_front(t1));
+    }
+    // Like adding a binary digit, with carry
+    static List<TreePtr> insTree(TreePtr const & t, List<TreePtr> const & ts)
+    {
+        if (ts.isEmpty() || t->_rank < ts.front()->_rank)
+            return ts.pushed_front(t);
+        return insTree(link(t, ts.front()), ts.popped_front());
+    }
+    static List<TreePtr> mergeTrees(List<TreePtr> const & ts1, List<TreePtr> const & ts2)
+    {
+        if (ts1.isEmpty())
+            return ts2;
+        if (ts2.isEmpty())
+            return ts1;
+        TreePtr t1 = ts1.front();
+        TreePtr t2 = ts2.front();
+        if (t1->_rank < t2->_rank)
+            return mergeTrees(ts1.popped_front(), ts2).pushed_front(t1);
+        if (t2->_rank < t1->_rank)
+            return mergeTrees(ts1, ts2.popped_front()).pushed_front(t2);
+        return insTree(link(t1, t2), mergeTrees(ts1.popped_front(), ts2.popped_front()));
+    }
+    // The tree with the smallest root, and the others
+    static std::pair<TreePtr, List<TreePtr>> removeMinTree(List<TreePtr> const & ts)
+    {
+        TreePtr t = ts.front();
+        List<TreePtr> rest = ts.popped_front();
+        if (rest.isEmpty())
+            return std::make_pair(t, rest);
+        auto minRest = removeMinTree(rest);
+        if (t->_v <= minRest.first->_v)
+            return std::make_pair(t, rest);
+        return std::make_pair(minRest.first, minRest.second.pushed_front(t));
+    }
+
+    List<TreePtr> _trees; // increasing rank
+};
+
+#endif
@@ -0,0 +1,161 @@
+#if ! defined(DARYHEAP_H)
+#define DARYHEAP_H
+
+#include "LeftistHeap.h"
+#include <cassert>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+// Ephemeral d-ary heap in a single array, for hot paths
+// that don't need persistence: no allocation per element,
+// and a node's D children share one or two cache lines.
+// push, pop: O(log n) (base D), front: O(1)
+//
+// It also has the interface of the persistent heaps
+// (inserted, popped_front, merged), which modifies
+// and returns the heap. It only works on rvalues:
+//     h = std::move(h).popped_front();
+// so that an O(n) copy is never made by accident.
+// To keep the old version, copy it explicitly:
+//     auto h2 = h.copied().popped_front();
+
+template<class T, int D = 4>
+class DaryHeap
+{
+    static_assert(D >= 2, "a heap needs at least two children per node");
+public:
+    DaryHeap() {}
+    explicit DaryHeap(T x) : _a(1, x) {}
+    DaryHeap(std::initializer_list<T> init) : _a(init)
+    {
+        heapify();
+    }
+    // Conversions to and from the persistent leftist heap: O(n)
+    explicit DaryHeap(Heap<T> const & h)
+    {
+        h.forEach([this](T const & x)
+        {
+            _a.push_back(x);
+        });
+        heapify();
+    }
+    Heap<T> toLeftist() const
+    {
+        return Heap<T>::bulkHeapify(_a.begin(), _a.end());
+    }
+
+    bool isEmpty() const { return _a.empty(); }
+    int size() const { return static_cast<int>(_a.size()); }
+    void reserve(int n) { _a.reserve(n); }
+    T front() const
+    {
+        assert(!isEmpty());
+        return _a.front();
+    }
+    void push(T x)
+    {
+        _a.push_back(std::move(x));
+        siftUp(_a.size() - 1);
+    }
+    // Sifts the new elements up one by one, unless there are
+    // so many of them that rebuilding the whole heap is cheaper
+    template<class Iter>
+    void push_range(Iter b, Iter e)
+    {
+        std::size_t old = _a.size();
+        _a.insert(_a.end(), b, e);
+        if (_a.size() - old > old / 2)
+            heapify();
+        else
+        {
+            for (std::size_t i = old; i < _a.size(); ++i)
+                siftUp(i);
+        }
+    }
+    void pop()
+    {
+        assert(!isEmpty());
+        _a.front() = std::move(_a.back());
+        _a.pop_back();
+        if (!_a.empty())
+            siftDown(0);
+    }
+    void merge(DaryHeap const & other)
+    {
+        push_range(other._a.begin(), other._a.end());
+    }
+
+    // O(n)
+    DaryHeap copied() const { return *this; }
+
+    // The interface of the persistent heaps
+    DaryHeap inserted(T x) &&
+    {
+        push(std::move(x));
+        return std::move(*this);
+    }
+    DaryHeap popped_front() &&
+    {
+        pop();
+        return std::move(*this);
+    }
+    static DaryHeap merged(DaryHeap h1, DaryHeap h2)
+    {
+        if (h1.size() < h2.size())
+            std::swap(h1, h2);
+        h1.merge(h2);
+        return h1;
+    }
+private:
+    // Moves the hole instead of swapping
+    void siftUp(std::size_t i)
+    {
+        T x = std::move(_a[i]);
+        while (i > 0)
+        {
+            std::size_t parent = (i - 1) / D;
+            if (_a[parent] <= x)
+                break;
+            _a[i] = std::move(_a[parent]);
+            i = parent;
+        }
+        _a[i] = std::move(x);
+    }
+    void siftDown(std::size_t i)
+    {
+        std::size_t n = _a.size();
+        T x = std::move(_a[i]);
+        for (;;)
+        {
+            std::size_t first = D * i + 1;
+            if (first >= n)
+                break;
+            std::size_t last = first + D < n ? first + D : n;
+            std::size_t smallest = first;
+            for (std::size_t c = first + 1; c < last; ++c)
+            {
+                if (_a[c] < _a[smallest])
+                    smallest = c;
+            }
+            if (x <= _a[smallest])
+                break;
+            _a[i] = std::move(_a[smallest]);
+            i = smallest;
+        }
+        _a[i] = std::move(x);
+    }
+    // Bottom-up, O(n)
+    void heapify()
+    {
+        if (_a.size() < 2)
+            return;
+        // from the parent of the last element
+        for (std::size_t i = (_a.size() - 2) / D + 1; i-- > 0; )
+            siftDown(i);
+    }
+
+    std::vector<T> _a;
+};
+
+#endif
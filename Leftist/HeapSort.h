@@ -0,0 +1,85 @@
+#if ! defined(HEAPSORT_H)
+#define HEAPSORT_H
+
+#include "LeftistHeap.h"
+#include "../PureStream/PureStream.h"
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// Sorting and merging with the leftist heap
+
+// Sorts [b, e) in place: O(n log n)
+// The heap is never shared, so popping relinks its nodes
+// instead of copying them
+template<class Iter>
+void heapSort(Iter b, Iter e)
+{
+    using T = typename std::iterator_traits<Iter>::value_type;
+    using Tree = typename Heap<T>::Tree;
+    std::shared_ptr<const Tree> root = Heap<T>::bulkHeapify(b, e)._tree;
+    std::vector<Tree *> picked;
+    for (Iter it = b; it != e; ++it)
+    {
+        Tree * t = const_cast<Tree *>(root.get());
+        *it = t->_v;
+        root = Heap<T>::mergedInPlace(std::move(t->_left), std::move(t->_right), picked);
+    }
+}
+
+// A sorted run (List, OrdList, or anything with
+// isEmpty, front and popped_front) in the heap of runs,
+// ordered by its head; ties go to the earlier run
+template<class Run>
+struct RunHead
+{
+    RunHead() : _index(0) {}
+    RunHead(Run const & run, int index) : _run(run), _index(index) {}
+    bool operator<(RunHead const & other) const
+    {
+        return _run.front() < other._run.front()
+            || (!(other._run.front() < _run.front()) && _index < other._index);
+    }
+    bool operator<=(RunHead const & other) const
+    {
+        return !(other < *this);
+    }
+    Run _run;
+    int _index;
+};
+
+template<class Run>
+auto mergedRuns(Heap<RunHead<Run>> const & heads) -> Stream<decltype(heads.front()._run.front())>
+{
+    using T = decltype(heads.front()._run.front());
+    if (heads.isEmpty())
+        return Stream<T>();
+    return Stream<T>([heads]()
+    {
+        RunHead<Run> top = heads.front();
+        Heap<RunHead<Run>> rest = heads.popped_front();
+        Run tail = top._run.popped_front();
+        if (!tail.isEmpty())
+            rest = rest.inserted(RunHead<Run>(tail, top._index));
+        return Cell<T>(top._run.front(), mergedRuns(rest));
+    });
+}
+
+// Lazy k-way merge of the sorted runs in [b, e): each element
+// of the stream costs O(log k), instead of O(k) when merging
+// the runs pairwise. Stable: equal elements keep the order of their runs.
+template<class Iter>
+auto kWayMerged(Iter b, Iter e) -> Stream<decltype((*b).front())>
+{
+    using Run = typename std::iterator_traits<Iter>::value_type;
+    std::vector<RunHead<Run>> heads;
+    int index = 0;
+    for (Iter it = b; it != e; ++it, ++index)
+    {
+        if (!it->isEmpty())
+            heads.push_back(RunHead<Run>(*it, index));
+    }
+    return mergedRuns(Heap<RunHead<Run>>::bulkHeapify(heads.begin(), heads.end()));
+}
+
+#endif
@@ -1,5 +1,11 @@
+#if ! defined(LEFTISTHEAP_H)
+#define LEFTISTHEAP_H
+
+#include "../Helper/Arena.h"
 #include <memory>
 #include <cassert>
+#include <initializer_list>
+#include <vector>
 
 template<class T>
 class Heap
@@ -26,8 +32,6 @@ private:
         : _tree(tree) {}
     Heap(T x, Heap const & a, Heap const & b)
     {
-        a.assertInv();
-        b.assertInv();
         assert(a.isEmpty() || x <= a.front());
         assert(b.isEmpty() || x <= b.front());
         // rank is the length of the right spine
@@ -35,7 +39,6 @@ private:
             _tree = std::make_shared<const Tree>(b.rank() + 1, x, a._tree, b._tree);
         else
             _tree = std::make_shared<const Tree>(a.rank() + 1, x, b._tree, a._tree);
-        assertInv();
     }
     Heap<T>  left() const
     {
@@ -47,15 +50,39 @@ private:
         assert(!isEmpty());
         return Heap(_tree->_right);
     }
-    void assertInv() const
+    static int rankOf(std::shared_ptr<const Tree> const & t)
+    {
+        return t ? t->_rank : 0;
+    }
+    // Like merged, but relinks the nodes instead of copying them
+    // Only for nodes that bulkHeapify made (non-const) and nobody shares
+    static std::shared_ptr<const Tree> mergedInPlace(std::shared_ptr<const Tree> a
+                                                   , std::shared_ptr<const Tree> b
+                                                   , std::vector<Tree *> & picked)
     {
-        if (!isEmpty())
+        picked.clear();
+        std::shared_ptr<const Tree> res;
+        std::shared_ptr<const Tree> * slot = &res;
+        while (a && b)
         {
-            // left bias
-            assert(left().rank() >= right().rank());
-            left().assertInv();
-            right().assertInv();
+            if (b->_v < a->_v)
+                std::swap(a, b);
+            Tree * t = const_cast<Tree *>(a.get());
+            picked.push_back(t);
+            std::shared_ptr<const Tree> next = std::move(t->_right);
+            *slot = std::move(a);
+            slot = &t->_right;
+            a = std::move(next);
         }
+        *slot = a ? std::move(a) : std::move(b);
+        for (auto it = picked.rbegin(); it != picked.rend(); ++it)
+        {
+            Tree * t = *it;
+            if (rankOf(t->_left) < rankOf(t->_right))
+                std::swap(t->_left, t->_right);
+            t->_rank = rankOf(t->_right) + 1;
+        }
+        return res;
     }
 public:
     Heap() {}
@@ -63,8 +90,8 @@ public:
     {}
     Heap(std::initializer_list<T> init)
     {
-        _tree = heapify(init.begin(), init.end())._tree;
-        assertInv();
+        _tree = bulkHeapify(init.begin(), init.end())._tree;
+        assert(isValid());
     }
     template<class Iter>
     static Heap heapify(Iter b, Iter e)
@@ -79,6 +106,40 @@ public:
             return merged(heapify(b, mid), heapify(mid, e));
         }
     }
+    // Linear time from any input range (Okasaki, exercise 3.3):
+    // singletons are merged in pairs, round after round.
+    // No recursion; all the nodes come from a single arena block,
+    // which is freed when the last of them is.
+    template<class Iter>
+    static Heap bulkHeapify(Iter b, Iter e)
+    {
+        std::vector<T> vals(b, e);
+        if (vals.empty())
+            return Heap();
+        NodeArena * arena = NodeArena::create(vals.size());
+        ArenaAllocator<Tree> alloc(arena);
+        std::vector<std::shared_ptr<const Tree>> heaps;
+        heaps.reserve(vals.size());
+        for (T const & v : vals)
+            heaps.push_back(std::allocate_shared<Tree>(alloc, v));
+        arena->release();
+
+        std::vector<Tree *> picked;
+        while (heaps.size() > 1)
+        {
+            std::size_t half = 0;
+            for (std::size_t i = 0; i + 1 < heaps.size(); i += 2)
+                heaps[half++] = mergedInPlace(std::move(heaps[i]), std::move(heaps[i + 1]), picked);
+            if (heaps.size() % 2)
+                heaps[half++] = std::move(heaps.back());
+            heaps.resize(half);
+        }
+        return Heap(heaps.front());
+    }
+    // Pops the nodes of a heap it built, in place (HeapSort.h)
+    template<class Iter>
+    friend void heapSort(Iter b, Iter e);
+
     bool isEmpty() const { return !_tree; }
     int rank() const
     {
@@ -86,6 +147,51 @@ public:
         else return _tree->_rank;
     }
     T front() const { return _tree->_v; }
+    // Visits every element, in no particular order
+    template<class F>
+    void forEach(F f) const
+    {
+        std::vector<Tree const *> todo;
+        if (_tree)
+            todo.push_back(_tree.get());
+        while (!todo.empty())
+        {
+            Tree const * t = todo.back();
+            todo.pop_back();
+            f(t->_v);
+            if (t->_left)
+                todo.push_back(t->_left.get());
+            if (t->_right)
+                todo.push_back(t->_right.get());
+        }
+    }
+    // Checks ranks, left bias and heap order of the whole tree: O(n)
+    // Call it explicitly, e.g. assert(h.isValid())
+    bool isValid() const
+    {
+        std::vector<Tree const *> todo;
+        if (_tree)
+            todo.push_back(_tree.get());
+        while (!todo.empty())
+        {
+            Tree const * t = todo.back();
+            todo.pop_back();
+            int lrank = t->_left ? t->_left->_rank : 0;
+            int rrank = t->_right ? t->_right->_rank : 0;
+            if (t->_rank != rrank + 1 || lrank < rrank)
+                return false;
+            for (Tree const * kid : { t->_left.get(), t->_right.get() })
+            {
+                if (kid)
+                {
+                    if (kid->_v < t->_v)
+                        return false;
+                    todo.push_back(kid);
+                }
+            }
+        }
+        return true;
+    }
     Heap popped_front() const 
     {
         return merged(left(), right()); 
@@ -95,15 +201,33 @@ public:
         return merged(Heap(x), *this);
     }
     // merged along right spines: log time
+    // Walks down the two spines picking the smaller root,
+    // then rebuilds the picked nodes bottom-up
     static Heap merged(Heap const & h1, Heap const & h2)
     {
-        if (h1.isEmpty())
-            return h2;
-        if (h2.isEmpty())
-            return h1;
-        if (h1.front() <= h2.front())
-            return Heap(h1.front(), h1.left(), merged(h1.right(), h2));
-        else
-            return Heap(h2.front(), h2.left(), merged(h1, h2.right()));
+        // h1 and h2 keep all these nodes alive
+        std::vector<Tree const *> picked;
+        picked.reserve(h1.rank() + h2.rank());
+        std::shared_ptr<const Tree> const * a = &h1._tree;
+        std::shared_ptr<const Tree> const * b = &h2._tree;
+        while (*a && *b)
+        {
+            if ((*a)->_v <= (*b)->_v)
+            {
+                picked.push_back(a->get());
+                a = &(*a)->_right;
+            }
+            else
+            {
+                picked.push_back(b->get());
+                b = &(*b)->_right;
+            }
+        }
+        Heap res(*a ? *a : *b);
+        for (auto it = picked.rbegin(); it != picked.rend(); ++it)
+            res = Heap((*it)->_v, Heap((*it)->_left), res);
+        return res;
     }
-};
\ No newline at end of file
+};
+
+#endif
@@ -1,5 +1,20 @@
 #include "LeftistHeap.h"
+#include "BinomialHeap.h"
+#include "SkewBinomialHeap.h"
+#include "PairingHeap.h"
+#include "DaryHeap.h"
+#include "AddressableHeap.h"
+#include "HeapSort.h"
+#include "../OrdList/OrdList.h"
 #include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <sstream>
+#include <iterator>
+#include <utility>
+#include <limits>
+#include <algorithm>
 
 template<class T>
 void printHeap(Heap<T> const & h)
@@ -17,8 +32,433 @@ void testInit()
 {
     Heap<int> h{ 50, 40, 30, 10, 20, 30, 100, 0, 45, 55, 25, 15 };
     printHeap(h);
+    Heap<int> big;
+    for (int i = 0; i < 100000; ++i)
+        big = big.inserted(i * 7919 % 100003);
+    std::cout << "Valid: " << h.isValid() << ", " << big.isValid()
+        << ", " << Heap<int>::merged(big, h).popped_front().isValid() << std::endl;
 }
 
+// Pops everything, checking the order
+template<class H>
+bool drainsSorted(H h, int n)
+{
+    int count = 0;
+    int prev = h.isEmpty() ? 0 : h.front();
+    while (!h.isEmpty())
+    {
+        if (h.front() < prev)
+            return false;
+        prev = h.front();
+        h = h.popped_front();
+        ++count;
+    }
+    return count == n;
+}
+
+template<class H>
+void testHeap(char const * label)
+{
+    std::vector<int> v = { 50, 40, 30, 10, 20, 30, 100, 0, 45, 55, 25, 15 };
+    H h;
+    for (int x : v)
+        h = h.inserted(x);
+    H h2 = H::merged(h, H(5).inserted(60));
+    std::cout << label << ": " << h.front() << ", " << h.popped_front().front()
+        << ", merged: " << h2.popped_front().front()
+        << ", sorted: " << drainsSorted(h2, 14) << std::endl;
+}
+
+long long msSince(std::chrono::steady_clock::time_point start)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+// Three traces over the same random keys:
+// insert-heavy: n inserts, n/16 pops
+// pop-heavy:    pop all of a heap of n
+// merge-heavy:  merge n/16 heaps of 16, one at a time, into one
+template<class H>
+void benchHeap(char const * label, std::vector<int> const & keys)
+{
+    int n = static_cast<int>(keys.size());
+    auto start = std::chrono::steady_clock::now();
+    H h;
+    for (int x : keys)
+        h = h.inserted(x);
+    for (int i = 0; i < n / 16; ++i)
+        h = h.popped_front();
+    long long insMs = msSince(start);
+
+    H full;
+    for (int x : keys)
+        full = full.inserted(x);
+    start = std::chrono::steady_clock::now();
+    while (!full.isEmpty())
+        full = full.popped_front();
+    long long popMs = msSince(start);
+
+    std::vector<H> small((n + 15) / 16);
+    for (int i = 0; i < n; ++i)
+        small[i / 16] = small[i / 16].inserted(keys[i]);
+    start = std::chrono::steady_clock::now();
+    H all;
+    for (H const & s : small)
+        all = H::merged(all, s);
+    long long mergeMs = msSince(start);
+
+    std::cout << label << ": insert-heavy " << insMs << " ms, pop-heavy " << popMs
+        << " ms, merge-heavy " << mergeMs << " ms" << std::endl;
+    if (!drainsSorted(all, n))
+        std::cout << "Error: " << label << " out of order\n";
+}
+
+void testBench(int n)
+{
+    std::mt19937 gen(42);
+    std::vector<int> keys(n);
+    for (int & k : keys)
+        k = static_cast<int>(gen() % 1000000000);
+    std::cout << n << " keys" << std::endl;
+    benchHeap<Heap<int>>("Leftist", keys);
+    benchHeap<BinomialHeap<int>>("Binomial", keys);
+    benchHeap<SkewBinomialHeap<int>>("Skew binomial", keys);
+    benchHeap<PairingHeap<int>>("Pairing", keys);
+}
+
+// Building a heap of n keys up front
+void testBulk(int n)
+{
+    std::istringstream in("42 7 19 3 25");
+    auto small = Heap<int>::bulkHeapify(std::istream_iterator<int>(in), std::istream_iterator<int>());
+    printHeap(small);
+
+    std::mt19937 gen(7);
+    std::vector<int> keys(n);
+    for (int & k : keys)
+        k = static_cast<int>(gen() % 1000000000);
+    auto start = std::chrono::steady_clock::now();
+    Heap<int> h1;
+    for (int k : keys)
+        h1 = h1.inserted(k);
+    long long insMs = msSince(start);
+    start = std::chrono::steady_clock::now();
+    auto h2 = Heap<int>::heapify(keys.begin(), keys.end());
+    long long heapifyMs = msSince(start);
+    start = std::chrono::steady_clock::now();
+    auto h3 = Heap<int>::bulkHeapify(keys.begin(), keys.end());
+    long long bulkMs = msSince(start);
+    std::cout << n << " keys. One by one: " << insMs << " ms, heapify: " << heapifyMs
+        << " ms, bulkHeapify: " << bulkMs << " ms" << std::endl;
+    if (!h3.isValid() || h3.front() != h1.front() || !drainsSorted(h3, n))
+        std::cout << "Error: bulkHeapify\n";
+}
+
+// The ephemeral array heap, through its own interface
+// and through the persistent one (on rvalues)
+void testDary()
+{
+    DaryHeap<int> d{ 50, 40, 30, 10, 20, 30, 100, 0, 45, 55, 25, 15 };
+    std::vector<int> more = { 5, 60, 35 };
+    d.push_range(more.begin(), more.end());
+    Heap<int> h = d.toLeftist();
+    DaryHeap<int> back(h);
+    back = std::move(back).inserted(-1).popped_front();
+    std::cout << "Dary: " << d.front() << ", size " << d.size()
+        << ", to leftist and back: " << back.front() << ", " << back.size() << std::endl;
+    // keeping the old version takes an explicit copy
+    DaryHeap<int> d2 = d.copied().popped_front();
+    if (d2.size() != d.size() - 1 || d2.front() < d.front())
+        std::cout << "Error: copied heap\n";
+    std::cout << "Sorted: " << drainsSorted(h, 15) << ", ";
+    for (int i = 0; i < 15; ++i)
+    {
+        if (back.front() != d.front())
+            std::cout << "Error: conversion\n";
+        back.pop();
+        d.pop();
+    }
+    std::cout << "empty: " << (d.isEmpty() && back.isEmpty()) << std::endl;
+}
+
+// A hot priority queue: n pushes, then pops interleaved
+// with pushes of larger keys, like an event queue
+template<class Push, class Pop, class H>
+long long runEvents(H & h, std::vector<int> const & keys, Push push, Pop pop)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int k : keys)
+        push(h, k);
+    long long sum = 0;
+    for (int k : keys)
+    {
+        sum += h.front();
+        int next = h.front() + k % 1000;
+        pop(h);
+        push(h, next);
+    }
+    while (!h.isEmpty())
+    {
+        sum += h.front();
+        pop(h);
+    }
+    long long ms = msSince(start);
+    if (sum == 0)
+        std::cout << "Error: no events\n";
+    return ms;
+}
+
+template<int D>
+long long runDary(std::vector<int> const & keys)
+{
+    DaryHeap<int, D> d;
+    d.reserve(static_cast<int>(keys.size()));
+    return runEvents(d, keys, [](DaryHeap<int, D> & h, int k) { h.push(k); }
+                            , [](DaryHeap<int, D> & h) { h.pop(); });
+}
+
+void benchDary(int n)
+{
+    std::mt19937 gen(11);
+    std::vector<int> keys(n);
+    for (int & k : keys)
+        k = static_cast<int>(gen() % 100000000);
+    Heap<int> h;
+    long long leftistMs = runEvents(h, keys, [](Heap<int> & h, int k) { h = h.inserted(k); }
+                                           , [](Heap<int> & h) { h = h.popped_front(); });
+    std::cout << n << " events. Leftist: " << leftistMs << " ms, binary: " << runDary<2>(keys)
+        << " ms, 4-ary: " << runDary<4>(keys) << " ms, 8-ary: " << runDary<8>(keys) << " ms" << std::endl;
+}
+
+void testAddressable()
+{
+    AddressableHeap<int> h;
+    std::vector<AddressableHeap<int>::Handle> hs;
+    for (int x : { 50, 40, 30, 10, 20, 30, 100, 0, 45, 55, 25, 15 })
+        hs.push_back(h.push(x));
+    h.decrease(hs[6], 5);   // 100 -> 5
+    h.erase(hs[7]);         // 0
+    h.erase(hs[0]);         // 50
+    std::cout << "Addressable, size " << h.size() << ": ";
+    while (!h.isEmpty())
+    {
+        std::cout << h.front() << ", ";
+        h.pop();
+    }
+    std::cout << std::endl;
+}
+
+// Random sparse graph: a ring, so that every vertex is reachable,
+// plus random edges
+struct Graph
+{
+    struct Edge { int _to; int _w; };
+    std::vector<std::vector<Edge>> _adj;
+};
+
+Graph makeGraph(int n, int degree)
+{
+    std::mt19937 gen(5);
+    Graph g;
+    g._adj.resize(n);
+    for (int v = 0; v < n; ++v)
+    {
+        g._adj[v].push_back(Graph::Edge{ (v + 1) % n, 1000 });
+        for (int i = 1; i < degree; ++i)
+            g._adj[v].push_back(Graph::Edge{ static_cast<int>(gen() % n), static_cast<int>(1 + gen() % 1000) });
+    }
+    return g;
+}
+
+int const infinity = std::numeric_limits<int>::max();
+
+// Each vertex is in the heap at most once, relaxing an edge lowers its key
+std::vector<int> dijkstraDecrease(Graph const & g, int & maxHeap)
+{
+    using Entry = std::pair<int, int>; // distance, vertex
+    int n = static_cast<int>(g._adj.size());
+    std::vector<int> dist(n, infinity);
+    std::vector<AddressableHeap<Entry>::Handle> handles(n);
+    std::vector<bool> queued(n, false);
+    AddressableHeap<Entry> h;
+    dist[0] = 0;
+    handles[0] = h.push(Entry(0, 0));
+    queued[0] = true;
+    maxHeap = 1;
+    while (!h.isEmpty())
+    {
+        int v = h.front().second;
+        h.pop();
+        queued[v] = false;
+        for (auto const & e : g._adj[v])
+        {
+            int d = dist[v] + e._w;
+            if (d < dist[e._to])
+            {
+                if (queued[e._to])
+                    h.decrease(handles[e._to], Entry(d, e._to));
+                else if (dist[e._to] == infinity)
+                {
+                    handles[e._to] = h.push(Entry(d, e._to));
+                    queued[e._to] = true;
+                }
+                dist[e._to] = d;
+            }
+        }
+        maxHeap = std::max(maxHeap, h.size());
+    }
+    return dist;
+}
+
+// Relaxing an edge pushes the vertex again; stale entries are skipped
+template<class H>
+std::vector<int> dijkstraDuplicates(Graph const & g, int & maxHeap)
+{
+    using Entry = std::pair<int, int>;
+    int n = static_cast<int>(g._adj.size());
+    std::vector<int> dist(n, infinity);
+    H h;
+    int size = 1;
+    dist[0] = 0;
+    h = std::move(h).inserted(Entry(0, 0));
+    maxHeap = 1;
+    while (!h.isEmpty())
+    {
+        Entry top = h.front();
+        h = std::move(h).popped_front();
+        --size;
+        if (top.first > dist[top.second])
+            continue;
+        for (auto const & e : g._adj[top.second])
+        {
+            int d = top.first + e._w;
+            if (d < dist[e._to])
+            {
+                dist[e._to] = d;
+                h = std::move(h).inserted(Entry(d, e._to));
+                maxHeap = std::max(maxHeap, ++size);
+            }
+        }
+    }
+    return dist;
+}
+
+void benchDijkstra(int n, int degree)
+{
+    Graph g = makeGraph(n, degree);
+    int maxDecrease, maxLeftist, maxDary;
+    auto start = std::chrono::steady_clock::now();
+    auto d1 = dijkstraDecrease(g, maxDecrease);
+    long long decreaseMs = msSince(start);
+    start = std::chrono::steady_clock::now();
+    auto d2 = dijkstraDuplicates<Heap<std::pair<int, int>>>(g, maxLeftist);
+    long long leftistMs = msSince(start);
+    start = std::chrono::steady_clock::now();
+    auto d3 = dijkstraDuplicates<DaryHeap<std::pair<int, int>>>(g, maxDary);
+    long long daryMs = msSince(start);
+    std::cout << "Dijkstra, " << n << " vertices, " << n * degree << " edges. "
+        << "Decrease-key: " << decreaseMs << " ms, max heap " << maxDecrease
+        << ". Duplicates, leftist: " << leftistMs << " ms, 4-ary: " << daryMs
+        << " ms, max heap " << maxLeftist << std::endl;
+    if (d1 != d2 || d1 != d3)
+        std::cout << "Error: distances differ\n";
+}
+
+void testKWay()
+{
+    std::vector<List<int>> runs = { { 1, 4, 9 }, {}, { 2, 3, 10, 11 }, { 0, 4 } };
+    std::cout << "Merged runs: ";
+    forEach(kWayMerged(runs.begin(), runs.end()), [](int x)
+    {
+        std::cout << x << ", ";
+    });
+    std::cout << std::endl;
+    std::vector<int> v = { 50, 40, 30, 10, 20, 30, 100, 0, 45, 55, 25, 15 };
+    heapSort(v.begin(), v.end());
+    std::cout << "Heap sorted: " << std::is_sorted(v.begin(), v.end()) << std::endl;
+}
+
+// Sorted OrdList runs of about n / k random keys
+std::vector<OrdList<int>> makeRuns(int n, int k)
+{
+    std::mt19937 gen(13);
+    std::vector<OrdList<int>> runs(k);
+    for (int r = 0; r < k; ++r)
+    {
+        std::vector<int> keys(n / k);
+        for (int & x : keys)
+            x = static_cast<int>(gen() % 1000000);
+        std::sort(keys.begin(), keys.end());
+        for (auto it = keys.rbegin(); it != keys.rend(); ++it)
+            runs[r] = OrdList<int>(*it, runs[r]);
+    }
+    return runs;
+}
+
+// k-way merge against folding OrdList's merged over the runs
+// (merged recurses once per element, so n stays small)
+void benchKWay(int n)
+{
+    std::cout << n << " keys in k runs, k-way / pairwise (ms):";
+    for (int k = 2; k <= 1024; k *= 2)
+    {
+        auto runs = makeRuns(n, k);
+        auto start = std::chrono::steady_clock::now();
+        long long sum1 = 0;
+        forEach(kWayMerged(runs.begin(), runs.end()), [&sum1](int x)
+        {
+            sum1 += x;
+        });
+        long long kWayMs = msSince(start);
+        start = std::chrono::steady_clock::now();
+        OrdList<int> all;
+        for (auto const & run : runs)
+            all = merged(all, run);
+        long long sum2 = 0;
+        for (; !all.isEmpty(); all = all.popped_front())
+            sum2 += all.front();
+        long long pairMs = msSince(start);
+        std::cout << " " << k << ": " << kWayMs << "/" << pairMs;
+        if (sum1 != sum2)
+            std::cout << " Error: sums differ";
+    }
+    std::cout << std::endl;
+}
+
+void benchHeapSort(int n)
+{
+    std::mt19937 gen(17);
+    std::vector<int> keys(n);
+    for (int & k : keys)
+        k = static_cast<int>(gen() % 1000000000);
+    std::vector<int> sorted = keys;
+    auto start = std::chrono::steady_clock::now();
+    heapSort(keys.begin(), keys.end());
+    long long heapMs = msSince(start);
+    start = std::chrono::steady_clock::now();
+    std::sort(sorted.begin(), sorted.end());
+    long long stdMs = msSince(start);
+    std::cout << n << " keys. heapSort: " << heapMs << " ms, std::sort: " << stdMs << " ms" << std::endl;
+    if (keys != sorted)
+        std::cout << "Error: heapSort\n";
+}
+
+/* Release build (-O2 -DNDEBUG)
+1000000 keys. One by one: 609 ms, heapify: 213 ms, bulkHeapify: 142 ms
+1000000 events. Leftist: 5040 ms, binary: 369 ms, 4-ary: 391 ms, 8-ary: 418 ms
+Dijkstra, 200000 vertices, 1600000 edges. Decrease-key: 287 ms, max heap 124096. Duplicates, leftist: 1550 ms, 4-ary: 192 ms, max heap 214053
+20000 keys in k runs, k-way / pairwise (ms): 2: 5/1 4: 6/2 8: 8/6 16: 13/14 32: 27/30 64: 16/64 128: 23/101 256: 23/244 512: 36/483 1024: 37/1079
+1000000 keys. heapSort: 1646 ms, std::sort: 123 ms
+200000 keys
+Leftist: insert-heavy 136 ms, pop-heavy 487 ms, merge-heavy 14 ms
+Binomial: insert-heavy 166 ms, pop-heavy 1321 ms, merge-heavy 6 ms
+Skew binomial: insert-heavy 189 ms, pop-heavy 1422 ms, merge-heavy 13 ms
+Pairing: insert-heavy 407 ms, pop-heavy 841 ms, merge-heavy 3 ms
+Before the leftist heap stopped checking its invariant at every node,
+5000 keys took 568, 829 and 37 ms
+*/
+
 void main()
 {
     Heap<int> h;
@@ -28,4 +468,17 @@ void main()
     Heap<int> h2 = h1.inserted(102);
     printHeap(h2);
     testInit();
+    testHeap<Heap<int>>("Leftist");
+    testHeap<BinomialHeap<int>>("Binomial");
+    testHeap<SkewBinomialHeap<int>>("Skew binomial");
+    testHeap<PairingHeap<int>>("Pairing");
+    testBulk(1000000);
+    testDary();
+    benchDary(1000000);
+    testAddressable();
+    benchDijkstra(200000, 8);
+    testKWay();
+    benchKWay(20000);
+    benchHeapSort(1000000);
+    testBench(200000);
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+#if ! defined(PAIRINGHEAP_H)
+#define PAIRINGHEAP_H
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+// Persistent pairing heap (Okasaki, 5.5)
+// A heap-ordered multiway tree, stored as first child/next sibling
+// inserted, merged, front: O(1)
+// popped_front: O(log n) amortized, by merging the subtrees in pairs.
+// The amortized bound only holds when each version is popped once:
+// popping the same version again pays for the same pairing again.
+
+template<class T>
+class PairingHeap
+{
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+    struct Node
+    {
+        Node(T v, NodePtr const & kid, NodePtr const & next)
+            : _v(v), _kid(kid), _next(next)
+        {}
+        // Sibling lists and chains of first children can be
+        // as long as the heap: free them without recursion
+        ~Node()
+        {
+            std::vector<NodePtr> orphans;
+            adopt(orphans, _kid);
+            adopt(orphans, _next);
+            while (!orphans.empty())
+            {
+                NodePtr p = std::move(orphans.back());
+                orphans.pop_back();
+                adopt(orphans, p->_kid);
+                adopt(orphans, p->_next);
+            }
+        }
+        static void adopt(std::vector<NodePtr> & orphans, NodePtr & p)
+        {
+            if (p && p.use_count() == 1)
+                orphans.push_back(std::move(p));
+        }
+        T _v;
+        // mutable only so that the last owner can take them apart
+        mutable NodePtr _kid;
+        mutable NodePtr _next; // ignored in a root
+    };
+    explicit PairingHeap(NodePtr const & root) : _root(root) {}
+public:
+    PairingHeap() {}
+    explicit PairingHeap(T x) : _root(std::make_shared<const Node>(x, nullptr, nullptr)) {}
+    bool isEmpty() const { return !_root; }
+    T front() const
+    {
+        assert(!isEmpty());
+        return _root->_v;
+    }
+    PairingHeap popped_front() const
+    {
+        assert(!isEmpty());
+        std::vector<NodePtr> kids;
+        for (NodePtr k = _root->_kid; k; k = k->_next)
+            kids.push_back(k);
+        if (kids.empty())
+            return PairingHeap();
+        // left to right in pairs, then right to left
+        std::vector<NodePtr> pairs;
+        for (std::size_t i = 0; i + 1 < kids.size(); i += 2)
+            pairs.push_back(link(kids[i], kids[i + 1]));
+        std::size_t i = pairs.size();
+        NodePtr acc = kids.size() % 2 ? kids.back() : pairs[--i];
+        while (i-- > 0)
+            acc = link(pairs[i], acc);
+        return PairingHeap(acc);
+    }
+    PairingHeap inserted(T x) const
+    {
+        return merged(PairingHeap(x), *this);
+    }
+    static PairingHeap merged(PairingHeap const & h1, PairingHeap const & h2)
+    {
+        if (h1.isEmpty())
+            return h2;
+        if (h2.isEmpty())
+            return h1;
+        return PairingHeap(link(h1._root, h2._root));
+    }
+private:
+    // The larger root becomes the first child of the smaller
+    static NodePtr link(NodePtr const & a, NodePtr const & b)
+    {
+        if (a->_v <= b->_v)
+            return std::make_shared<const Node>(a->_v, std::make_shared<const Node>(b->_v, b->_kid, a->_kid), nullptr);
+        else
+            return std::make_shared<const Node>(b->_v, std::make_shared<const Node>(a->_v, a->_kid, b->_kid), nullptr);
+    }
+
+    NodePtr _root;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#if ! defined(SKEWBINOMIALHEAP_H)
+#define SKEWBINOMIALHEAP_H
+
+#include "../List/List.h"
+#include <cassert>
+#include <memory>
+#include <utility>
+
+// Persistent skew binomial heap (Okasaki, 9.3.2)
+// Like the binomial heap, but the ranks follow the skew binary
+// number system, where adding one never carries more than once:
+// only the two smallest trees may have the same rank
+// and inserted links at most those two.
+// Each tree also keeps a list of extra elements
+// that are no smaller than its root.
+// inserted: O(1) worst case
+// merged, popped_front, front: O(log n)
+
+template<class T>
+class SkewBinomialHeap
+{
+    struct Tree;
+    using TreePtr = std::shared_ptr<const Tree>;
+    struct Tree
+    {
+        Tree(int rank, T v, List<T> const & xs, List<TreePtr> const & kids)
+            : _rank(rank), _v(v), _xs(xs), _kids(kids)
+        {}
+        int _rank;
+        T   _v;
+        List<T> _xs;         // extra elements, >= _v
+        List<TreePtr> _kids;
+    };
+    explicit SkewBinomialHeap(List<TreePtr> const & trees) : _trees(trees) {}
+public:
+    SkewBinomialHeap() {}
+    explicit SkewBinomialHeap(T x) : _trees(singleton(x)) {}
+    bool isEmpty() const { return _trees.isEmpty(); }
+    T front() const
+    {
+        assert(!isEmpty());
+        T x = _trees.front()->_v;
+        _trees.forEach([&x](TreePtr const & t)
+        {
+            if (t->_v < x)
+                x = t->_v;
+        });
+        return x;
+    }
+    SkewBinomialHeap popped_front() const
+    {
+        assert(!isEmpty());
+        auto minRest = removeMinTree(_trees);
+        SkewBinomialHeap h(mergeTrees(normalize(reversed(minRest.first->_kids))
+                                    , normalize(minRest.second)));
+        minRest.first->_xs.forEach([&h](T x)
+        {
+            h = h.inserted(x);
+        });
+        return h;
+    }
+    SkewBinomialHeap inserted(T x) const
+    {
+        if (!isEmpty())
+        {
+            TreePtr t1 = _trees.front();
+            List<TreePtr> rest = _trees.popped_front();
+            if (!rest.isEmpty() && t1->_rank == rest.front()->_rank)
+                return SkewBinomialHeap(rest.popped_front().pushed_front(skewLink(x, t1, rest.front())));
+        }
+        return SkewBinomialHeap(_trees.pushed_front(singleton(x)));
+    }
+    static SkewBinomialHeap merged(SkewBinomialHeap const & h1, SkewBinomialHeap const & h2)
+    {
+        return SkewBinomialHeap(mergeTrees(normalize(h1._trees), normalize(h2._trees)));
+    }
+private:
+    static TreePtr singleton(T x)
+    {
+        return std::make_shared<const Tree>(0, x, List<T>(), List<TreePtr>());
+    }
+    static TreePtr link(TreePtr const & t1, TreePtr const & t2)
+    {
+        if (t1->_v <= t2->_v)
+            return std::make_shared<const Tree>(t1->_rank + 1, t1->_v, t1->_xs, t1->_kids.pushed_front(t2));
+        else
+            return std::make_shared<const Tree>(t2->_rank + 1, t2->_v, t2->_xs, t2->_kids.pushed_front(t1));
+    }
+    // Links two trees and a new element: the larger of x
+    // and the new root goes to the extra elements
+    static TreePtr skewLink(T x, TreePtr const & t1, TreePtr const & t2)
+    {
+        TreePtr t = link(t1, t2);
+        if (x <= t->_v)
+            return std::make_shared<const Tree>(t->_rank, x, t->_xs.pushed_front(t->_v), t->_kids);
+        else
+            return std::make_shared<const Tree>(t->_rank, t->_v, t->_xs.pushed_front(x), t->_kids);
+    }
+    static List<TreePtr> insTree(TreePtr const & t, List<TreePtr> const & ts)
+    {
+        if (ts.isEmpty() || t->_rank < ts.front()->_rank)
+            return ts.pushed_front(t);
+        return insTree(link(t, ts.front()), ts.popped_front());
+    }
+    // Both lists must be normalized
+    static List<TreePtr> mergeTrees(List<TreePtr> const & ts1, List<TreePtr> const & ts2)
+    {
+        if (ts1.isEmpty())
+            return ts2;
+        if (ts2.isEmpty())
+            return ts1;
+        TreePtr t1 = ts1.front();
+        TreePtr t2 = ts2.front();
+        if (t1->_rank < t2->_rank)
+            return mergeTrees(ts1.popped_front(), ts2).pushed_front(t1);
+        if (t2->_rank < t1->_rank)
+            return mergeTrees(ts1, ts2.popped_front()).pushed_front(t2);
+        return insTree(link(t1, t2), mergeTrees(ts1.popped_front(), ts2.popped_front()));
+    }
+    // Get rid of a leading pair of equal ranks
+    static List<TreePtr> normalize(List<TreePtr> const & ts)
+    {
+        if (ts.isEmpty())
+            return ts;
+        return insTree(ts.front(), ts.popped_front());
+    }
+    static std::pair<TreePtr, List<TreePtr>> removeMinTree(List<TreePtr> const & ts)
+    {
+        TreePtr t = ts.front();
+        List<TreePtr> rest = ts.popped_front();
+        if (rest.isEmpty())
+            return std::make_pair(t, rest);
+        auto minRest = removeMinTree(rest);
+        if (t->_v <= minRest.first->_v)
+            return std::make_pair(t, rest);
+        return std::make_pair(minRest.first, minRest.second.pushed_front(t));
+    }
+
+    List<TreePtr> _trees; // increasing rank, except for the first two
+};
+
+#endif
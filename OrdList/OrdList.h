@@ -1,3 +1,6 @@
+#if ! defined(ORDLIST_H)
+#define ORDLIST_H
+
 #include <cassert>
 #include <memory>
 #include <initializer_list>
@@ -74,3 +77,5 @@ void print(OrdList<T> lst)
         print(lst.popped_front());
     }
 }
+
+#endif
@@ -0,0 +1,92 @@
+#if ! defined(CATLIST_H)
+#define CATLIST_H
+
+#include "RealTimeQueue.h"
+#include "Susp.h"
+#include <cassert>
+#include <memory>
+
+// Catenable list (Okasaki, 10.2.1)
+// A list is either empty or a head with a queue of
+// suspended sublists: appending pushes the other list
+// onto the queue. Taking the tail links the sublists
+// one into another, lazily.
+// appended, pushed_front, pushed_back, front: O(1)
+// popped_front: O(1) amortized
+
+template<class T>
+class CatList
+{
+    // Shared, so that every copy sees the same memo
+    using Lazy = std::shared_ptr<SuspBase<CatList>>;
+    struct Node
+    {
+        Node(T x, RealTimeQueue<Lazy> const & q) : _x(x), _q(q) {}
+        T _x;
+        RealTimeQueue<Lazy> _q;
+    };
+    explicit CatList(std::shared_ptr<const Node> const & node) : _node(node) {}
+public:
+    CatList() {}
+    explicit CatList(T x) : _node(std::make_shared<const Node>(x, RealTimeQueue<Lazy>())) {}
+    bool isEmpty() const { return !_node; }
+    T front() const
+    {
+        assert(!isEmpty());
+        return _node->_x;
+    }
+    CatList popped_front() const
+    {
+        assert(!isEmpty());
+        if (_node->_q.isEmpty())
+            return CatList();
+        return linkAll(_node->_q);
+    }
+    CatList pushed_front(T x) const
+    {
+        return CatList(x).appended(*this);
+    }
+    CatList pushed_back(T x) const
+    {
+        return appended(CatList(x));
+    }
+    CatList appended(CatList const & other) const
+    {
+        if (isEmpty())
+            return other;
+        if (other.isEmpty())
+            return *this;
+        return link(*this, makeSusp([other]()
+        {
+            return other;
+        }));
+    }
+private:
+    static CatList link(CatList const & t, Lazy const & s)
+    {
+        return CatList(std::make_shared<const Node>(t._node->_x, t._node->_q.pushed_back(s)));
+    }
+    // Links each sublist into the previous one;
+    // all but the first link are suspended
+    static CatList linkAll(RealTimeQueue<Lazy> const & q)
+    {
+        CatList t = q.front()->get();
+        RealTimeQueue<Lazy> rest = q.popped_front();
+        if (rest.isEmpty())
+            return t;
+        return link(t, makeSusp([rest]()
+        {
+            return linkAll(rest);
+        }));
+    }
+
+    std::shared_ptr<const Node> _node;
+};
+
+template<class T>
+CatList<T> concat(CatList<T> const & a, CatList<T> const & b)
+{
+    return a.appended(b);
+}
+
+#endif
@@ -0,0 +1,91 @@
+#if ! defined(DEQUE_H)
+#define DEQUE_H
+
+#include "PureStream.h"
+#include <cassert>
+
+// Banker's deque (Okasaki, 8.4.2)
+// Two lazy streams, the rear one reversed, neither more than
+// c times longer than the other (plus one). When one gets too long,
+// half of it is moved, reversed, to the end of the other.
+// pushed_front, pushed_back, popped_front, popped_back: O(1) amortized
+
+template<class T>
+class Deque
+{
+    static const int c = 3; // balance
+public:
+    Deque() : _lenF(0), _lenR(0) {}
+    bool isEmpty() const { return _lenF + _lenR == 0; }
+    int size() const { return _lenF + _lenR; }
+    // With a single element, it may be in either stream
+    T front() const
+    {
+        assert(!isEmpty());
+        return _lenF == 0 ? _rear.get() : _front.get();
+    }
+    T back() const
+    {
+        assert(!isEmpty());
+        return _lenR == 0 ? _front.get() : _rear.get();
+    }
+    Deque pushed_front(T x) const
+    {
+        return check(_lenF + 1, Stream<T>(x, _front), _lenR, _rear);
+    }
+    Deque pushed_back(T x) const
+    {
+        return check(_lenF, _front, _lenR + 1, Stream<T>(x, _rear));
+    }
+    Deque popped_front() const
+    {
+        assert(!isEmpty());
+        if (_lenF == 0)
+            return Deque();
+        return check(_lenF - 1, _front.popped_front(), _lenR, _rear);
+    }
+    Deque popped_back() const
+    {
+        assert(!isEmpty());
+        if (_lenR == 0)
+            return Deque();
+        return check(_lenF, _front, _lenR - 1, _rear.popped_front());
+    }
+private:
+    Deque(int lf, Stream<T> const & f, int lr, Stream<T> const & r)
+        : _lenF(lf), _front(f), _lenR(lr), _rear(r)
+    {}
+    static Deque check(int lf, Stream<T> const & f, int lr, Stream<T> const & r)
+    {
+        if (lf > c * lr + 1)
+        {
+            int i = (lf + lr) / 2;
+            int j = lf + lr - i;
+            return Deque(i, f.take(i), j, concat(r, reversedFrom(f, i)));
+        }
+        if (lr > c * lf + 1)
+        {
+            int j = (lf + lr) / 2;
+            int i = lf + lr - j;
+            return Deque(i, concat(f, reversedFrom(r, j)), j, r.take(j));
+        }
+        return Deque(lf, f, lr, r);
+    }
+    // Suspended s.drop(n).reversed(): paid for by the
+    // operations before it's reached
+    static Stream<T> reversedFrom(Stream<T> const & s, int n)
+    {
+        return Stream<T>([s, n]()
+        {
+            Stream<T> rev = s.drop(n).reversed();
+            return Cell<T>(rev.get(), rev.popped_front());
+        });
+    }
+
+    int _lenF;
+    Stream<T> _front;
+    int _lenR;
+    Stream<T> _rear;
+};
+
+#endif
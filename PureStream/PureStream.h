@@ -1,19 +1,26 @@
+#if ! defined(PURESTREAM_H)
+#define PURESTREAM_H
+
 #include <cassert>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "Susp.h"
+#include "../Helper/QueueIter.h"
 
-template<class T>
+template<class T, class P = SingleThreaded>
 class Stream;
 
 // A Cell contains a value and a (lazy) Stream
 
-template<class T>
+template<class T, class P = SingleThreaded>
 class Cell
 {
 public:
-    Cell() {} // only to initialize _memo
-    Cell(T v, Stream<T> tail)
+    Cell(T v, Stream<T, P> tail)
         : _v(v), _tail(std::move(tail))
     {}
     explicit Cell(T v) : _v(v) {}
@@ -21,56 +28,68 @@ public:
     {
         return _v;
     }
-    Stream<T> popped_front() const
+    Stream<T, P> popped_front() const
     {
         return _tail;
     }
 private:
     T _v;
-    Stream<T> _tail;
+    Stream<T, P> _tail;
 };
 
 // CellFun is a function object that creates a Cell 
 // containing a given value and a Stream
 
-template<class T>
+template<class T, class P = SingleThreaded>
 class CellFun
 {
 public:
-    CellFun(T v, Stream<T> s) : _v(v), _s(std::move(s)) {}
+    CellFun(T v, Stream<T, P> s) : _v(v), _s(std::move(s)) {}
     explicit CellFun(T v) : _v(v) {}
 
-    Cell<T> operator()()
+    Cell<T, P> operator()()
     {
-        return Cell<T>(_v, _s);
+        return Cell<T, P>(_v, _s);
     }
     T _v;
-    Stream<T> _s;
+    Stream<T, P> _s;
 };
 
 // Stream is either empty
 // or contains a suspended Cell
+// P is the policy of its suspensions (see Susp.h): every stream
+// made from a ThreadSafe stream is ThreadSafe, and can be
+// walked by many threads at once
 
-template<class T>
+template<class T, class P>
 class Stream
 {
 private:
-    std::shared_ptr <Susp<Cell<T>>> _lazyCell;
+    std::shared_ptr<SuspBase<Cell<T, P>, P>> _lazyCell;
 public:
     Stream() {}
     explicit Stream(T v)
     {
-        auto f = CellFun<T>(v);
-        _lazyCell = std::make_shared<Susp<Cell<T>>>(f);
+        _lazyCell = makeSusp<P>(CellFun<T, P>(v));
     }
     Stream(T v, Stream s)
     {
-        auto f = CellFun<T>(v, std::move(s));
-        _lazyCell = std::make_shared<Susp<Cell<T>>>(f);
+        _lazyCell = makeSusp<P>(CellFun<T, P>(v, std::move(s)));
     }
-    Stream(std::function<Cell<T>()> f)
-        : _lazyCell(std::make_shared<Susp<Cell<T>>>(f))
+    // Any function object that returns a Cell
+    template<class F, class = typename std::enable_if<
+        std::is_convertible<decltype(std::declval<F &>()()), Cell<T, P>>::value>::type>
+    Stream(F f)
+        : _lazyCell(makeSusp<P>(std::move(f)))
     {}
+    // A cell that is evaluated right away: one allocation,
+    // no closure, for values we already have
+    static Stream forced(T v, Stream s)
+    {
+        Stream strm;
+        strm._lazyCell = std::make_shared<SuspBase<Cell<T, P>, P>>(Cell<T, P>(v, std::move(s)));
+        return strm;
+    }
     bool isEmpty() const
     {
         return !_lazyCell;
@@ -79,7 +98,7 @@ public:
     {
         return _lazyCell->get().val();
     }
-    Stream<T> popped_front() const
+    Stream popped_front() const
     {
         return _lazyCell->get().popped_front();
     }
@@ -98,65 +117,75 @@ public:
         {
             auto v = cell->get().val();
             auto t = cell->get().popped_front();
-            return Cell<T>(v, t.take(n - 1));
+            return Cell<T, P>(v, t.take(n - 1));
         });
     }
+    // A loop, so that dropping a long prefix doesn't grow the stack
     Stream drop(int n) const
     {
-        if (n == 0)
-            return *this;
-        if (isEmpty())
-            return Stream();
-        auto t = popped_front();
-        return t.drop(n - 1);
+        Stream s = *this;
+        for (; n > 0 && !s.isEmpty(); --n)
+            s = s.popped_front();
+        return s;
     }
     // Lazy reversed
     Stream reversed() const
     {
-        return rev(Stream());
-    }
-private:
-    Stream rev(Stream acc) const
-    {
-        if (isEmpty())
-            return acc;
-        auto v = get();
-        auto t = popped_front();
-        Stream nextAcc([=]
+        Stream acc;
+        for (Stream s = *this; !s.isEmpty(); s = s.popped_front())
         {
-            return Cell<T>(v, acc);
-        });
-        return t.rev(nextAcc);
+            auto v = s.get();
+            acc = Stream([v, acc]
+            {
+                return Cell<T, P>(v, acc);
+            });
+        }
+        return acc;
     }
 };
 
 // Lazy concatentation of two streams
 
-template<class T>
-Stream<T> concat( Stream<T> lft
-                , Stream<T> rgt)
+template<class T, class P>
+Stream<T, P> concat( Stream<T, P> lft
+                   , Stream<T, P> rgt)
 {
     if (lft.isEmpty())
         return rgt;
-    return Stream<T>([=]()
+    return Stream<T, P>([=]()
     {
-        return Cell<T>(lft.get(), concat<T>(lft.popped_front(), rgt));
+        return Cell<T, P>(lft.get(), concat<T>(lft.popped_front(), rgt));
     });
 }
 
-template<class T, class U, class F>
-auto zipWith(F f, Stream<T> lft, Stream<U> rgt) -> Stream<decltype(f(lft.get(), rgt.get()))>
+template<class T, class U, class P, class F>
+auto zipWith(F f, Stream<T, P> lft, Stream<U, P> rgt) -> Stream<decltype(f(lft.get(), rgt.get())), P>
 {
     using S = decltype(f(lft.get(), rgt.get()));
     if (lft.isEmpty() || rgt.isEmpty())
-        return Stream<S>();
-    return Stream<S>([=]()
+        return Stream<S, P>();
+    return Stream<S, P>([=]()
     {
-        return Cell<S>(f(lft.get(), rgt.get()), zipWith(f, lft.popped_front(), rgt.popped_front()));
+        return Cell<S, P>(f(lft.get(), rgt.get()), zipWith(f, lft.popped_front(), rgt.popped_front()));
     });
 }
 
-Stream<int> ints(int n)
+// Lazy map: each forced cell lets go of the one it was computed from
+template<class T, class P, class F>
+auto fmap(Stream<T, P> stm, F f)->Stream<decltype(f(stm.get())), P>
+{
+    using U = decltype(f(stm.get()));
+    static_assert(std::is_convertible<F, std::function<U(T)>>::value,
+        "fmap requires a function type U(T)");
+
+    if (stm.isEmpty()) return Stream<U, P>();
+    return Stream<U, P>([stm, f]()
+    {
+        return Cell<U, P>(f(stm.get()), fmap(stm.popped_front(), f));
+    });
+}
+
+inline Stream<int> ints(int n)
 {
     return Stream<int>([=]()
     {
@@ -164,8 +193,8 @@ Stream<int> ints(int n)
     });
 }
 
-template<class T, class F>
-void forEach(Stream<T> strm, F f)
+template<class T, class P, class F>
+void forEach(Stream<T, P> strm, F f)
 {
     while (!strm.isEmpty())
     {
@@ -196,6 +225,41 @@ public:
     {
         return check(_lenF - 1, _front.popped_front(), _lenR, _rear);
     }
+    // Batches: the whole range goes onto the rear in one pass,
+    // as cells that are already evaluated, with a single check
+    template<class Iter>
+    Queue pushed_back_range(Iter b, Iter e) const
+    {
+        int lr = _lenR;
+        Stream<T> r = _rear;
+        for (; b != e; ++b, ++lr)
+            r = Stream<T>::forced(*b, std::move(r));
+        return check(_lenF, _front, lr, std::move(r));
+    }
+    Queue popped_front_n(int n) const
+    {
+        assert(n <= _lenF + _lenR);
+        if (n <= _lenF)
+            return check(_lenF - n, _front.drop(n), _lenR, _rear);
+        // The front runs out: what's left are the k newest elements,
+        // the first k cells of the rear. They become the front, oldest first.
+        // k < _lenR <= _lenF < n, so this costs less than the pops.
+        int k = _lenF + _lenR - n;
+        Stream<T> f;
+        Stream<T> r = _rear;
+        for (int i = 0; i < k; ++i, r = r.popped_front())
+            f = Stream<T>::forced(r.get(), std::move(f));
+        return check(k, std::move(f), 0, Stream<T>());
+    }
+    int size() const { return _lenF + _lenR; }
+    // Front to back, without rotating the rear into the front
+    QueueIter<T, Stream<T>> begin() const { return QueueIter<T, Stream<T>>(_front, _lenF, _rear, _lenR); }
+    QueueIter<T, Stream<T>> end() const { return QueueIter<T, Stream<T>>(); }
+    // A snapshot, front to back, in one allocation
+    std::vector<T> toVector() const
+    {
+        return queueToVector<T>(_front, _lenF, _rear, _lenR);
+    }
     // for debugging only
     int lenF() const { return _lenF; }
     int lenR() const { return _lenR; }
@@ -214,3 +278,5 @@ private:
     int _lenR;
     Stream<T> _rear;
 };
+
+#endif
@@ -0,0 +1,64 @@
+#if ! defined(REALTIMEQUEUE_H)
+#define REALTIMEQUEUE_H
+
+#include "PureStream.h"
+#include "../List/List.h"
+
+// Real-time queue (Okasaki, 7.2)
+// Like the lazy Queue, the front is a lazy stream and
+// the rear has to be reversed onto it from time to time.
+// Here the rotation is built one cell at a time,
+// and the schedule points at the first cell of the front
+// that hasn't been forced yet: every operation forces
+// exactly one more, so that no operation ever forces more
+// than one step of a rotation.
+// front, pushed_back, popped_front: O(1) worst case,
+// even when old versions are used again (persistently)
+
+template<class T>
+class RealTimeQueue
+{
+public:
+    RealTimeQueue() {}
+    bool isEmpty() const { return _front.isEmpty(); }
+    T front() const { return _front.get(); }
+    RealTimeQueue pushed_back(T x) const
+    {
+        return exec(_front, _rear.pushed_front(x), _sched);
+    }
+    RealTimeQueue popped_front() const
+    {
+        return exec(_front.popped_front(), _rear, _sched);
+    }
+private:
+    // Invariant: |sched| = |front| - |rear|
+    RealTimeQueue(Stream<T> const & f, List<T> const & r, Stream<T> const & s)
+        : _front(f), _rear(r), _sched(s)
+    {}
+    // Lazy f ++ reversed(r) ++ a, for |r| = |f| + 1
+    // Forcing a cell forces one cell of f, which has already been forced
+    static Stream<T> rotate(Stream<T> f, List<T> r, Stream<T> a)
+    {
+        return Stream<T>([f, r, a]()
+        {
+            if (f.isEmpty())
+                return Cell<T>(r.front(), a);
+            return Cell<T>(f.get(), rotate(f.popped_front(), r.popped_front(), Stream<T>(r.front(), a)));
+        });
+    }
+    // Forces one cell of the schedule,
+    // or starts a rotation when the schedule runs out
+    static RealTimeQueue exec(Stream<T> const & f, List<T> const & r, Stream<T> const & s)
+    {
+        if (!s.isEmpty())
+            return RealTimeQueue(f, r, s.popped_front());
+        Stream<T> rotated = rotate(f, r, Stream<T>());
+        return RealTimeQueue(rotated, List<T>(), rotated);
+    }
+
+    Stream<T> _front;
+    List<T>   _rear;  // reversed
+    Stream<T> _sched; // a suffix of _front
+};
+
+#endif
@@ -1,59 +1,161 @@
+#if ! defined(SUSP_H)
+#define SUSP_H
+
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "../Helper/ForceOnce.h"
+
 // This is a suspension for value of type T
-// Value is accessed through a thunk
-// Originally the thunk is set to "thunkForce",
-// which will force the evaluation and memoization
-// of the suspended value
-// After that the thunk is switched to "thunkGet",
-// which simply accesses the memoized value
+// The value is computed by a closure the first time it's needed
+// and memoized in place: T needs no default constructor.
+// After that the closure is destroyed, releasing whatever
+// it captured, and get() only tests the state and returns the memo.
+// SuspBase<T> is what the users of a suspension see;
+// Susp<T, F> stores a closure of type F inline,
+// Susp<T> erases it with std::function.
+// The policy P says what happens when two threads force it.
+// Only SingleThreaded suspensions can be copied: a copy made while
+// another thread is forcing would see half a closure and no memo.
+// ThreadSafe ones are shared through a shared_ptr (see makeSusp).
 
-// This is not thread safe!
+// Policies
 
-template<class T>
-class Susp
+// Nothing is synchronized: not to be shared between threads
+struct SingleThreaded
+{
+    class State
+    {
+    public:
+        explicit State(bool forced) : _forced(forced) {}
+        bool isForced() const { return _forced; }
+        template<class Eval>
+        void force(Eval eval) const
+        {
+            if (!_forced)
+            {
+                eval(); // if it throws, we stay unforced
+                _forced = true;
+            }
+        }
+    private:
+        mutable bool _forced;
+    };
+};
+
+// Evaluated once, by whichever thread gets there first;
+// the others wait for it, then read the memo it published
+// (see ForceOnce.h)
+struct ThreadSafe
+{
+    typedef ForceOnce State;
+};
+
+template<class T, class P = SingleThreaded>
+class SuspBase
 {
-    // thunk
-    static T const & thunkForce(Susp const * susp)
+protected:
+    typedef void (*eval_t)(SuspBase const *);
+    explicit SuspBase(eval_t eval) : _eval(eval), _state(false) {}
+    SuspBase(SuspBase const & other) : _eval(other._eval), _state(other._state)
     {
-        return susp->setMemo();
+        static_assert(std::is_same<P, SingleThreaded>::value,
+            "only SingleThreaded suspensions can be copied");
+        if (isForced())
+            new (&_memo) T(other.memo());
     }
-    // thunk
-    static T const & thunkGet(Susp const * susp)
+    SuspBase(SuspBase && other) : _eval(other._eval), _state(other._state)
     {
-        return susp->getMemo();
+        static_assert(std::is_same<P, SingleThreaded>::value,
+            "only SingleThreaded suspensions can be moved");
+        if (isForced())
+            new (&_memo) T(std::move(other.memo()));
     }
-
-    T const & getMemo() const
+    SuspBase & operator=(SuspBase const &) = delete;
+public:
+    // Already forced: for values that are known up front
+    explicit SuspBase(T v) : _eval(nullptr), _state(true)
     {
-        return _memo;
+        new (&_memo) T(std::move(v));
     }
-    T const & setMemo() const
+    ~SuspBase()
     {
-        _memo = _f();
-        _thunk = thunkGet;
-        return getMemo();
+        if (isForced())
+            memo().~T();
     }
-public:
-    Susp() {} // needed if you want to suspend a Susp
-    explicit Susp(std::function<T()> f)
-        : _f(f), _thunk(&thunkForce), _memo(T())
-    {}
     T const & get() const
     {
-        return _thunk(this);
+        _state.force([this]() { _eval(this); });
+        return memo();
     }
     // We use it for debugging
     bool isForced() const
     {
-        return _thunk == &thunkGet;
+        return _state.isForced();
     }
-private:
-    typedef T const & (*thunk_t)(Susp const *);
-    mutable thunk_t _thunk;
-    mutable T   _memo;
+protected:
+    T & memo() const { return *reinterpret_cast<T *>(&_memo); }
 
-    std::function<T()> _f;
+    eval_t _eval; // constructs the memo, destroys the closure
+    typename P::State _state;
+    mutable typename std::aligned_storage<sizeof(T), alignof(T)>::type _memo;
+};
+
+template<class T, class F = std::function<T()>, class P = SingleThreaded>
+class Susp : public SuspBase<T, P>
+{
+    using Base = SuspBase<T, P>;
+    static void eval(Base const * base)
+    {
+        Susp const * susp = static_cast<Susp const *>(base);
+        new (&susp->_memo) T(susp->closure()());
+        susp->closure().~F();
+    }
+    F & closure() const { return *reinterpret_cast<F *>(&_f); }
+public:
+    explicit Susp(F f) : Base(&eval)
+    {
+        new (&_f) F(std::move(f));
+    }
+    Susp(Susp const & other) : Base(other)
+    {
+        if (!other.isForced())
+            new (&_f) F(other.closure());
+    }
+    Susp(Susp && other) : Base(std::move(other))
+    {
+        if (!other.isForced())
+            new (&_f) F(std::move(other.closure()));
+    }
+    Susp & operator=(Susp const & other)
+    {
+        if (this != &other)
+        {
+            Susp tmp(other);
+            this->~Susp();
+            new (this) Susp(std::move(tmp));
+        }
+        return *this;
+    }
+    ~Susp()
+    {
+        if (!this->isForced())
+            closure().~F();
+    }
+private:
+    mutable typename std::aligned_storage<sizeof(F), alignof(F)>::type _f;
 };
 
+// Shared suspension with the closure stored inline:
+// one allocation for the count, the closure and the memo
+template<class P = SingleThreaded, class F>
+auto makeSusp(F f) -> std::shared_ptr<SuspBase<decltype(f()), P>>
+{
+    return std::make_shared<Susp<decltype(f()), F, P>>(std::move(f));
+}
+
 template<class T, class F>
 auto fmap(Susp<T> const & susp, F f) -> Susp<decltype(f(susp.get()))>
 {
@@ -95,4 +197,6 @@ Susp<T> munit(T t)
     {
         return t;
     });
-}
\ No newline at end of file
+}
+
+#endif
@@ -1,9 +1,19 @@
 #include "PureStream.h"
+#include "RealTimeQueue.h"
+#include "Deque.h"
+#include "CatList.h"
 #include "../List/List.h"
 #include <iostream>
 #include <vector>
 #include <numeric>
 #include <string>
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
 
 Susp<std::vector<int>> ints(int from, int to)
 {
@@ -190,6 +200,131 @@ Stream<int> testCat()
     return concatAll(lss);
 }
 
+struct NoDefault
+{
+    explicit NoDefault(int i) : _i(i) {}
+    int _i;
+};
+
+// The closure goes away when forced, taking its captures with it
+void testSusp()
+{
+    auto captured = std::make_shared<int>(42);
+    auto lazy = makeSusp([captured]() { return NoDefault(*captured); });
+    Susp<int> copied([captured]() { return *captured + 1; });
+    Susp<int> copy = copied;
+    bool ok = captured.use_count() == 4 && !lazy->isForced();
+    ok = ok && lazy->get()._i == 42 && lazy->isForced() && captured.use_count() == 3;
+    ok = ok && copy.get() == 43 && !copied.isForced() && captured.use_count() == 2;
+    copied = copy; // forced
+    ok = ok && copied.isForced() && copied.get() == 43 && captured.use_count() == 1;
+    int tries = 0;
+    Susp<int> throwing([&tries]() -> int
+    {
+        if (++tries == 1)
+            throw std::runtime_error("first try");
+        return tries;
+    });
+    try
+    {
+        throwing.get();
+        ok = false;
+    }
+    catch (std::runtime_error const &) {}
+    ok = ok && !throwing.isForced() && throwing.get() == 2 && throwing.get() == 2;
+    std::cout << (ok ? "Susp OK\n" : "Error: Susp\n");
+}
+
+// Counts its live instances: how much of a stream is kept alive
+struct Counted
+{
+    Counted(long long v = 0) : _v(v) { ++live; }
+    Counted(Counted const & other) : _v(other._v) { ++live; }
+    ~Counted() { --live; }
+    Counted & operator=(Counted const &) = default;
+    long long _v;
+    static long long live;
+};
+
+long long Counted::live = 0;
+
+Stream<Counted> countedFrom(long long n)
+{
+    return Stream<Counted>([n]()
+    {
+        return Cell<Counted>(Counted(n), countedFrom(n + 1));
+    });
+}
+
+// Holding on to the head of a mapped stream keeps the mapped cells,
+// but not the ones they were computed from; walking without holding
+// the head keeps next to nothing, however long the stream
+void testRetention(int n)
+{
+    auto twice = [](Counted const & c) { return Counted(2 * c._v); };
+    long long held;
+    {
+        Stream<Counted> mapped = fmap(countedFrom(0).take(10000), twice);
+        forEach(mapped, [](Counted const &) {});
+        held = Counted::live;
+    }
+    auto start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    long long maxLive = 0;
+    // Built apart: a temporary in the call would hold the head
+    // until the end of the statement
+    Stream<Counted> mapped = fmap(countedFrom(0), twice).take(n);
+    forEach(std::move(mapped), [&sum, &maxLive](Counted const & c)
+    {
+        sum += c._v;
+        maxLive = std::max(maxLive, Counted::live);
+    });
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Mapped head holds " << held << " values. Streamed " << n << " in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+        << " ms, at most " << maxLive << " live" << std::endl;
+    if (held > 10000 + 10 || maxLive > 10 || sum != (long long)n * (n - 1) || Counted::live != 0)
+        std::cout << "Error: streams kept alive\n";
+}
+
+Stream<int, ThreadSafe> countedInts(int n, int to, std::atomic<int> & evals)
+{
+    if (n == to)
+        return Stream<int, ThreadSafe>();
+    return Stream<int, ThreadSafe>([n, to, &evals]()
+    {
+        ++evals;
+        return Cell<int, ThreadSafe>(n, countedInts(n + 1, to, evals));
+    });
+}
+
+// Threads walk the same stream, and what's made of it, while it's
+// being forced: each cell is evaluated once, and all see the same values
+void testSharedStream(int n, int k)
+{
+    std::atomic<int> evals(0);
+    Stream<int, ThreadSafe> shared = fmap(countedInts(0, n, evals), [](int i) { return 2 * i; }).take(n);
+    std::vector<long long> sums(k);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < k; ++i)
+    {
+        threads.emplace_back([&shared, &sums, i]()
+        {
+            forEach(shared, [&sums, i](int x) { sums[i] += x; });
+        });
+    }
+    for (std::thread & t : threads)
+        t.join();
+    auto end = std::chrono::steady_clock::now();
+    bool ok = evals == n;
+    for (long long sum : sums)
+        ok = ok && sum == (long long)n * (n - 1);
+    std::cout << k << " threads share a stream of " << n << ": "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms"
+        << (ok ? "" : ", Error: evaluated " + std::to_string(evals) + " times") << std::endl;
+}
+
 int testMonad()
 {
     Susp<int> x = mjoin(fmap(ints(1, 4), sum));
@@ -219,11 +354,472 @@ Stream<int> testZip()
 }
 
 
-void main()
+// The strict queue from Queue/Queue.h, without its debugging output:
+// reverses the whole rear, every time a version with an empty front is popped
+
+template<class T>
+class BatchedQueue
+{
+public:
+    BatchedQueue() {}
+    bool isEmpty() const { return _front.isEmpty(); }
+    T front() const { return _front.front(); }
+    BatchedQueue popped_front() const { return check(_front.popped_front(), _rear); }
+    BatchedQueue pushed_back(T v) const { return check(_front, _rear.pushed_front(v)); }
+private:
+    BatchedQueue(List<T> const & f, List<T> const & r) : _front(f), _rear(r) {}
+    static BatchedQueue check(List<T> const & f, List<T> const & r)
+    {
+        if (!f.isEmpty())
+            return BatchedQueue(f, r);
+        // not List's reversed, whose foldl recurses once per element
+        List<T> rev;
+        r.forEach([&rev](T v)
+        {
+            rev = rev.pushed_front(v);
+        });
+        return BatchedQueue(rev, List<T>());
+    }
+    List<T> _front;
+    List<T> _rear;
+};
+
+void testRealTimeQ()
+{
+    RealTimeQueue<int> q;
+    for (int i = 1; i <= 5; ++i)
+        q = q.pushed_back(i);
+    auto q1 = q.popped_front().pushed_back(6);
+    std::cout << "Real-time queue: " << q.front() << ", " << q1.front() << ": ";
+    for (; !q1.isEmpty(); q1 = q1.popped_front())
+        std::cout << q1.front() << " ";
+    std::cout << std::endl;
+}
+
+// Histogram of latencies by decade
+class Latencies
+{
+public:
+    Latencies() : _max(0) { std::fill(_counts, _counts + 5, 0); }
+    template<class F>
+    void time(F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        int bucket = 0;
+        for (long long limit = 1000; bucket < 4 && ns >= limit; limit *= 10)
+            ++bucket;
+        ++_counts[bucket];
+        _max = std::max(_max, ns);
+    }
+    void print(char const * label) const
+    {
+        std::cout << label << ": <1us " << _counts[0] << ", <10us " << _counts[1]
+            << ", <100us " << _counts[2] << ", <1ms " << _counts[3]
+            << ", >=1ms " << _counts[4] << ", max " << _max / 1000 << " us" << std::endl;
+    }
+private:
+    long long _counts[5];
+    long long _max;
+};
+
+// n pushes; then the same version is popped again and again,
+// as a persistent user would; then it's drained
+template<class Q>
+void benchQueue(char const * label, int n)
+{
+    Latencies lat;
+    Q q;
+    for (int i = 0; i < n; ++i)
+        lat.time([&q, i]() { q = q.pushed_back(i); });
+    long long sum = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        lat.time([&q, &sum]()
+        {
+            sum += q.popped_front().front();
+        });
+    }
+    while (!q.isEmpty())
+    {
+        lat.time([&q, &sum]()
+        {
+            sum += q.front();
+            q = q.popped_front();
+        });
+    }
+    lat.print(label);
+    if (sum != 100LL + static_cast<long long>(n) * (n - 1) / 2)
+        std::cout << "Error: " << label << " lost elements\n";
+}
+
+void testDeque()
+{
+    Deque<int> d;
+    for (int i = 1; i <= 5; ++i)
+        d = d.pushed_back(i).pushed_front(-i);
+    auto d1 = d.popped_back().popped_front();
+    std::cout << "Deque of " << d.size() << ": " << d.front() << " .. " << d.back()
+        << ", popped at both ends: " << d1.front() << " .. " << d1.back() << ": ";
+    for (; !d1.isEmpty(); d1 = d1.popped_back())
+        std::cout << d1.back() << " ";
+    std::cout << std::endl;
+}
+
+// Same contents as the std::deque, front to back
+bool sameDeque(Deque<int> d, std::deque<int> const & ref)
+{
+    if (d.size() != (int)ref.size())
+        return false;
+    for (int x : ref)
+    {
+        if (d.front() != x)
+            return false;
+        d = d.popped_front();
+    }
+    return d.isEmpty();
+}
+
+// Random pushes and pops at both ends, sometimes going on from
+// an older version; every version kept must still match its snapshot
+void testDequeRandom()
+{
+    std::mt19937 gen(5);
+    std::vector<std::pair<Deque<int>, std::deque<int>>> versions(1);
+    for (int round = 0; round < 2000; ++round)
+    {
+        auto v = gen() % 10 == 0 ? versions[gen() % versions.size()] : versions.back();
+        Deque<int> & d = v.first;
+        std::deque<int> & ref = v.second;
+        switch (ref.empty() ? gen() % 2 : gen() % 4)
+        {
+        case 0: d = d.pushed_front(round); ref.push_front(round); break;
+        case 1: d = d.pushed_back(round); ref.push_back(round); break;
+        case 2: d = d.popped_front(); ref.pop_front(); break;
+        default: d = d.popped_back(); ref.pop_back(); break;
+        }
+        if (!ref.empty() && (d.front() != ref.front() || d.back() != ref.back()))
+        {
+            std::cout << "Error: deque ends differ in round " << round << std::endl;
+            return;
+        }
+        versions.push_back(v);
+    }
+    for (std::size_t i = 0; i < versions.size(); ++i)
+    {
+        if (!sameDeque(versions[i].first, versions[i].second))
+        {
+            std::cout << "Error: deque version " << i << " changed\n";
+            return;
+        }
+    }
+    std::cout << "Deque OK, " << versions.size() << " versions\n";
+}
+
+// Maximum of each window of w values, with a deque of indices
+// whose values decrease from front to back
+template<class D, class PushBack, class PopBack, class PopFront>
+long long slidingMax(std::vector<int> const & a, int w, D & dq, PushBack pushBack, PopBack popBack, PopFront popFront)
+{
+    long long sum = 0;
+    for (int i = 0; i < static_cast<int>(a.size()); ++i)
+    {
+        while (!dq.empty() && a[dq.back()] <= a[i])
+            popBack(dq);
+        pushBack(dq, i);
+        if (dq.front() <= i - w)
+            popFront(dq);
+        if (i >= w - 1)
+            sum += a[dq.front()];
+    }
+    return sum;
+}
+
+// Gives Deque the names that slidingMax expects
+template<class T>
+struct PersistentWindow
+{
+    bool empty() const { return _d.isEmpty(); }
+    T front() const { return _d.front(); }
+    T back() const { return _d.back(); }
+    Deque<T> _d;
+};
+
+void benchSlidingWindow(int n, int w)
+{
+    std::mt19937 gen(3);
+    std::vector<int> a(n);
+    for (int & x : a)
+        x = static_cast<int>(gen() % 1000000);
+
+    auto start = std::chrono::steady_clock::now();
+    PersistentWindow<int> pw;
+    long long sum1 = slidingMax(a, w, pw
+        , [](PersistentWindow<int> & p, int i) { p._d = p._d.pushed_back(i); }
+        , [](PersistentWindow<int> & p) { p._d = p._d.popped_back(); }
+        , [](PersistentWindow<int> & p) { p._d = p._d.popped_front(); });
+    auto mid = std::chrono::steady_clock::now();
+    std::deque<int> sd;
+    long long sum2 = slidingMax(a, w, sd
+        , [](std::deque<int> & d, int i) { d.push_back(i); }
+        , [](std::deque<int> & d) { d.pop_back(); }
+        , [](std::deque<int> & d) { d.pop_front(); });
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Sliding max, " << n << " values, window " << w << ". Deque: "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(mid - start).count() << " ms, std::deque: "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(end - mid).count() << " ms" << std::endl;
+    if (sum1 != sum2)
+        std::cout << "Error: sliding max differs\n";
+}
+
+void testCatList()
+{
+    CatList<int> a = CatList<int>(1).pushed_back(2).pushed_back(3);
+    CatList<int> b = CatList<int>(5).pushed_front(4);
+    CatList<int> ab = concat(a, b);
+    CatList<int> aba = concat(ab, a).pushed_front(0);
+    std::cout << "Catenable list: ";
+    for (auto l = aba; !l.isEmpty(); l = l.popped_front())
+        std::cout << l.front() << " ";
+    std::cout << "| still there: " << ab.front() << ", " << a.popped_front().front() << std::endl;
+}
+
+// Appends k segments of m log lines (ints) at the end, then reads them all
+void benchCatList(int k, int m)
+{
+    std::vector<List<int>> lsegs;
+    std::vector<CatList<int>> csegs;
+    for (int s = 0; s < k; ++s)
+    {
+        List<int> l;
+        CatList<int> c;
+        for (int i = m; i-- > 0; )
+        {
+            l = l.pushed_front(s * m + i);
+            c = c.pushed_front(s * m + i);
+        }
+        lsegs.push_back(l);
+        csegs.push_back(c);
+    }
+    auto start = std::chrono::steady_clock::now();
+    CatList<int> call;
+    for (auto const & c : csegs)
+        call = concat(call, c);
+    long long csum = 0;
+    for (; !call.isEmpty(); call = call.popped_front())
+        csum += call.front();
+    auto mid = std::chrono::steady_clock::now();
+    List<int> lall;
+    for (auto const & l : lsegs)
+        lall = concat(lall, l);
+    long long lsum = 0;
+    lall.forEach([&lsum](int x)
+    {
+        lsum += x;
+    });
+    auto end = std::chrono::steady_clock::now();
+    std::cout << k << " segments of " << m << ". CatList: "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(mid - start).count() << " ms, List: "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(end - mid).count() << " ms" << std::endl;
+    if (csum != lsum)
+        std::cout << "Error: CatList lost lines\n";
+}
+
+// Random batches pushed and popped both ways must agree,
+// including pops that reach past the front into the rear
+void testQueueBatch()
+{
+    std::mt19937 gen(7);
+    Queue<int> one, bulk;
+    int next = 0;
+    for (int round = 0; round < 2000; ++round)
+    {
+        int k = gen() % 20;
+        if (gen() % 2)
+        {
+            std::vector<int> v;
+            for (int i = 0; i < k; ++i)
+                v.push_back(next++);
+            for (int x : v)
+                one = one.pushed_back(x);
+            bulk = bulk.pushed_back_range(v.begin(), v.end());
+        }
+        else
+        {
+            k = std::min(k, one.lenF() + one.lenR());
+            for (int i = 0; i < k; ++i)
+                one = one.popped_front();
+            bulk = bulk.popped_front_n(k);
+        }
+        if (one.lenF() + one.lenR() != bulk.lenF() + bulk.lenR()
+            || (!one.isEmpty() && one.front() != bulk.front()))
+        {
+            std::cout << "Error: batched queue differs in round " << round << std::endl;
+            return;
+        }
+    }
+    for (; !one.isEmpty(); one = one.popped_front(), bulk = bulk.popped_front())
+    {
+        if (one.front() != bulk.front())
+        {
+            std::cout << "Error: batched queue differs\n";
+            return;
+        }
+    }
+    std::cout << "Batched queue OK\n";
+}
+
+// Iteration and snapshots agree with popping, whatever the split
+// between front and rear
+void testQueueIter()
+{
+    std::mt19937 gen(11);
+    Queue<int> q;
+    std::deque<int> ref;
+    int next = 0;
+    for (int round = 0; round < 1000; ++round)
+    {
+        if (gen() % 3 != 0 || ref.empty())
+        {
+            q = q.pushed_back(next);
+            ref.push_back(next++);
+        }
+        else
+        {
+            q = q.popped_front();
+            ref.pop_front();
+        }
+        int lenR = q.lenR();
+        std::vector<int> walked(q.begin(), q.end());
+        std::vector<int> snap = q.toVector();
+        if (q.size() != (int)ref.size() || q.lenR() != lenR
+            || !std::equal(ref.begin(), ref.end(), walked.begin(), walked.end())
+            || snap != walked)
+        {
+            std::cout << "Error: queue iteration differs in round " << round << std::endl;
+            return;
+        }
+    }
+    // An iterator doesn't rely on the queue's invariant:
+    // all in the rear, nothing in front
+    Queue<int> allRear(0, Stream<int>(), 2, Stream<int>(2, Stream<int>(1)));
+    std::vector<int> walked(allRear.begin(), allRear.end());
+    if (walked != std::vector<int>{ 1, 2 } || allRear.toVector() != walked)
+    {
+        std::cout << "Error: iterating over the rear alone\n";
+        return;
+    }
+    static_assert(std::is_same<std::iterator_traits<decltype(q.begin())>::reference, int>::value,
+        "queue iterators return by value");
+    // Elements need not be default-constructible
+    Queue<std::reference_wrapper<const int>> refs;
+    for (int const & x : ref)
+        refs = refs.pushed_back(std::cref(x));
+    auto snap = refs.toVector();
+    if (refs.lenR() == 0 || snap.size() != ref.size() || snap.back().get() != ref.back()
+        || (*refs.begin()).get() != ref.front())
+    {
+        std::cout << "Error: snapshot of references\n";
+        return;
+    }
+    std::cout << "Queue iteration OK\n";
+}
+
+// n events, in batches, through the queue one by one or a batch at a time
+void benchQueueBatch(int n, int batch)
+{
+    std::vector<int> events(batch);
+    auto start = std::chrono::steady_clock::now();
+    long long sum1 = 0;
+    {
+        Queue<int> q;
+        for (int i = 0; i < n; i += batch)
+        {
+            for (int j = 0; j < batch; ++j)
+                q = q.pushed_back(i + j);
+            auto it = q.begin();
+            for (int j = 0; j < batch; ++j, ++it)
+                sum1 += *it;
+            for (int j = 0; j < batch; ++j)
+                q = q.popped_front();
+        }
+    }
+    auto mid = std::chrono::steady_clock::now();
+    long long sum2 = 0;
+    {
+        Queue<int> q;
+        for (int i = 0; i < n; i += batch)
+        {
+            std::iota(events.begin(), events.end(), i);
+            q = q.pushed_back_range(events.begin(), events.end());
+            auto it = q.begin();
+            for (int j = 0; j < batch; ++j, ++it)
+                sum2 += *it;
+            q = q.popped_front_n(batch);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ms1 = std::chrono::duration<double, std::milli>(mid - start).count();
+    double ms2 = std::chrono::duration<double, std::milli>(end - mid).count();
+    std::cout << n << " events in batches of " << batch << ". One by one: "
+        << n / ms1 / 1000 << " M/s, batched: " << n / ms2 / 1000 << " M/s" << std::endl;
+    if (sum1 != sum2)
+        std::cout << "Error: batched queue lost events\n";
+}
+
+/* Release build (-O2 -DNDEBUG), 100000 elements
+Batched: <1us 199052, <10us 937, <100us 7, <1ms 3, >=1ms 101, max 9234 us
+Lazy: <1us 200069, <10us 16, <100us 8, <1ms 3, >=1ms 4, max 3375 us
+Real-time: <1us 200031, <10us 61, <100us 7, <1ms 0, >=1ms 1, max 1402 us
+The batched queue reverses 100000 elements for every pop of the same version,
+the lazy queue reverses them in one go at each rotation.
+The real-time outlier moves from run to run: allocator or scheduler.
+Sliding max, 1000000 values, window 10. Deque: 92 ms, std::deque: 11 ms
+Sliding max, 1000000 values, window 1000. Deque: 80 ms, std::deque: 11 ms
+100 segments of 100. CatList: 2 ms, List: 31 ms
+1000 segments of 10. CatList: 3 ms, List: 360 ms
+1000000 events in batches of 100. One by one: 5.28698 M/s, batched: 7.54406 M/s
+1000000 events in batches of 10000. One by one: 4.51927 M/s, batched: 6.01031 M/s
+Both sides read each batch through the iterator; they differ in how they push and pop.
+With Susp holding the closure in place of a std::function, the deque
+went from 262 and 233 ms, the queues from 2.2 and 1.5 M/s.
+Mapped head holds 10000 values. Streamed 1000000 in 130 ms, at most 2 live
+With --long: Streamed 100000000 in 11460 ms, at most 2 live
+Peak RSS of testRetention on its own: 11096 KB for 1000000, 11084 KB for 100000000
+4 threads share a stream of 100000: 32 ms
+The shared stream goes last: once a program has started a thread,
+every shared_ptr count is atomic, and the benchmarks above
+lose a third to a half (deque 230 ms, queues 2.3-2.8 M/s).
+*/
+
+// --long streams 100M values through testRetention (half a minute)
+int main(int argc, char * argv[])
 {
+    bool longRuns = argc > 1 && std::string(argv[1]) == "--long";
     forcePrint(testZip());
     std::cout << testUnit() << std::endl;
     auto s = testCat();
     lazyPrint(s);
     forcePrint(s);
+    testSusp();
+    testRetention(longRuns ? 100000000 : 1000000);
+    testRealTimeQ();
+    benchQueue<BatchedQueue<int>>("Batched", 100000);
+    benchQueue<Queue<int>>("Lazy", 100000);
+    benchQueue<RealTimeQueue<int>>("Real-time", 100000);
+    testDeque();
+    testDequeRandom();
+    benchSlidingWindow(1000000, 10);
+    benchSlidingWindow(1000000, 1000);
+    testCatList();
+    benchCatList(100, 100);
+    benchCatList(1000, 10);
+    testQueueBatch();
+    testQueueIter();
+    benchQueueBatch(1000000, 100);
+    benchQueueBatch(1000000, 10000);
+    // last: once there are threads, shared_ptr counts are atomic
+    testSharedStream(100000, 4);
 }
@@ -1,6 +1,9 @@
 #include "../List/List.h"
 #include "../Helper/Utils.h"
+#include "../Helper/MPMCQueue.h"
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <vector>
 #include <algorithm>
@@ -80,7 +83,8 @@ bool PartSol::isAllowed(Pos const & pos) const
 
 bool PartSol::isAllowed(Pos const & pos) const
 {
-    return all(_queens, [&pos](Pos const & q){ return !isConflict(q, pos); });
+    auto allowed = [&pos](Pos const & q){ return !isConflict(q, pos); };
+    return all(_queens, allowed);
 }
 
 List<PartSol> PartSol::refine(int dim) const
@@ -150,6 +154,189 @@ std::vector<typename Partial::SolutionT> generatePar(int depth, Partial const &
     }
 }
 
+// Streams the solutions to sink as they are found, instead of
+// collecting them in futures: the partial solutions at the given depth
+// are handed out to a fixed pool of workers through one queue,
+// and the solutions come back through another.
+// sink is only called on the calling thread.
+template<class Partial, class Constraint, class Sink>
+void generateStreamed(int depth, Partial const & part, Constraint constr, int workers, Sink sink)
+{
+    using SolutionT = typename Partial::SolutionT;
+
+    std::vector<Partial> tasks{ part };
+    for (int d = 0; d < depth; ++d)
+    {
+        std::vector<Partial> next;
+        for (Partial const & p : tasks)
+        {
+            if (p.isFinished(constr))
+                sink(p.getSolution());
+            else
+                forEach(p.refine(constr), [&next](Partial const & q){ next.push_back(q); });
+        }
+        tasks.swap(next);
+    }
+    std::size_t cap = 2;
+    while (cap < tasks.size())
+        cap *= 2;
+    MPMCQueue<Partial> todo(cap);
+    todo.tryPushBatch(tasks.begin(), tasks.size());
+    MPMCQueue<SolutionT> results(1024);
+    std::atomic<int> done(0);
+
+    std::vector<std::thread> pool;
+    for (int i = 0; i < workers; ++i)
+    {
+        pool.emplace_back([&todo, &results, &done, constr]()
+        {
+            Partial p;
+            while (todo.tryPop(p))
+            {
+                std::vector<SolutionT> sols = generate(p, constr);
+                auto it = sols.begin();
+                while (it != sols.end())
+                {
+                    std::size_t k = results.tryPushBatch(it, sols.end() - it);
+                    if (k == 0)
+                        std::this_thread::yield(); // full: let the consumer in
+                    it += k;
+                }
+            }
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    std::vector<SolutionT> buf(64);
+    for (;;)
+    {
+        // read done first: whatever was pushed before it is in the queue
+        bool finished = done.load(std::memory_order_acquire) == workers;
+        std::size_t k = results.tryPopBatch(buf.begin(), buf.size());
+        for (std::size_t i = 0; i < k; ++i)
+            sink(buf[i]);
+        if (k == 0)
+        {
+            if (finished)
+                break;
+            std::this_thread::yield();
+        }
+    }
+    for (std::thread & t : pool)
+        t.join();
+}
+
+void testStreamed()
+{
+    bool ok = true;
+    for (int dim = 1; dim <= 9; ++dim)
+    {
+        std::vector<List<Pos>> par = generatePar(2, PartSol(), dim);
+        for (int workers = 1; workers <= 4; ++workers)
+        {
+            std::size_t count = 0;
+            generateStreamed(2, PartSol(), dim, workers, [&count, &ok, dim](List<Pos> const & queens)
+            {
+                int len = 0;
+                queens.forEach([&len](Pos const &){ ++len; });
+                if (len != dim)
+                    ok = false;
+                ++count;
+            });
+            if (count != par.size())
+            {
+                std::cout << "Error: " << dim << " queens, " << workers << " workers: streamed "
+                    << count << " solutions, expected " << par.size() << std::endl;
+                ok = false;
+            }
+        }
+    }
+    std::cout << (ok ? "Streamed search OK\n" : "Error: streamed search\n");
+}
+
+double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// n ints through the queue, from producers to consumers,
+// moved one at a time or in batches
+void benchMPMC(int producers, int consumers, int n, std::size_t batch)
+{
+    MPMCQueue<int> q(1024);
+    std::atomic<long long> sum(0);
+    std::atomic<int> left(n);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&q, p, producers, n, batch]()
+        {
+            std::vector<int> buf;
+            int i = p;
+            while (i < n)
+            {
+                buf.clear();
+                for (; i < n && buf.size() < batch; i += producers)
+                    buf.push_back(i);
+                auto it = buf.begin();
+                while (it != buf.end())
+                {
+                    std::size_t k = batch == 1 ? (q.tryPush(*it) ? 1 : 0)
+                                               : q.tryPushBatch(it, buf.end() - it);
+                    if (k == 0)
+                        std::this_thread::yield();
+                    it += k;
+                }
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&q, &sum, &left, batch]()
+        {
+            std::vector<int> buf(batch);
+            long long local = 0;
+            while (left.load(std::memory_order_relaxed) > 0)
+            {
+                std::size_t k = batch == 1 ? (q.tryPop(buf[0]) ? 1 : 0)
+                                           : q.tryPopBatch(buf.begin(), batch);
+                if (k == 0)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (std::size_t i = 0; i < k; ++i)
+                    local += buf[i];
+                left.fetch_sub((int)k, std::memory_order_relaxed);
+            }
+            sum += local;
+        });
+    }
+    for (std::thread & t : threads)
+        t.join();
+    double ms = msSince(start);
+    if (sum != (long long)n * (n - 1) / 2)
+        std::cout << "Error: the queue lost or duplicated elements\n";
+    std::cout << producers << "P/" << consumers << "C batch " << batch << ": "
+        << n / ms / 1000 << " M/s\n";
+}
+
+void benchQueens(int dim)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::size_t futures = generatePar(2, PartSol(), dim).size();
+    double msFut = msSince(start);
+    start = std::chrono::steady_clock::now();
+    std::size_t streamed = 0;
+    generateStreamed(2, PartSol(), dim, std::max(1u, std::thread::hardware_concurrency()),
+        [&streamed](List<Pos> const &) { ++streamed; });
+    double msStream = msSince(start);
+    if (futures != streamed)
+        std::cout << "Error: streamed " << streamed << " solutions, futures " << futures << std::endl;
+    std::cout << dim << " queens, " << streamed << " solutions: futures "
+        << msFut << " ms, streamed " << msStream << " ms\n";
+}
+
 void main()
 {
     std::vector<List<Pos>> sol = generatePar(3, PartSol(), 8);
@@ -157,5 +344,30 @@ void main()
     {
         std::cout << queens << std::endl;
     });
+    testStreamed();
+    const int n = 4000000;
+    for (int threads = 1; threads <= 4; threads *= 2)
+    {
+        benchMPMC(threads, threads, n, 1);
+        benchMPMC(threads, threads, n, 32);
+    }
+    benchMPMC(4, 1, n, 32);
+    benchMPMC(1, 4, n, 32);
+    benchQueens(11);
 }
 
+
+/* Release build (-O2 -DNDEBUG), single core machine, n = 4000000 ints,
+   queue of 1024:
+1P/1C batch 1: 26.0726 M/s
+1P/1C batch 32: 166.019 M/s
+2P/2C batch 1: 22.6016 M/s
+2P/2C batch 32: 127.45 M/s
+4P/4C batch 1: 23.7259 M/s
+4P/4C batch 32: 111.951 M/s
+4P/1C batch 32: 135.846 M/s
+1P/4C batch 32: 117.378 M/s
+11 queens, 2680 solutions: futures 115.169 ms, streamed 119.407 ms
+   On one core the threads only take turns, so these measure the
+   cost of the handoff, not contention on the position counters.
+*/
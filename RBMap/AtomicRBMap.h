@@ -0,0 +1,80 @@
+#if ! defined(ATOMICRBMAP_H)
+#define ATOMICRBMAP_H
+
+#include "RBMap.h"
+#include <atomic>
+#include <memory>
+
+// Publishes successive versions of a persistent RBMap
+// to many readers and writers.
+// Readers take a snapshot, which they can query at leisure:
+// it's immutable and keeps its nodes alive.
+// Writers compute a new version from the current one
+// and publish it with compare-and-swap, retrying on conflict.
+// Where the library has std::atomic<std::shared_ptr> (C++20), the
+// current version is kept in one; each map then has its own lock bit,
+// packed into the pointer word. Otherwise it falls back on the
+// std::atomic_load/atomic_compare_exchange_weak overloads for shared_ptr,
+// which in libstdc++ go through a global pool of mutexes hashed by address.
+// Neither path is lock-free in libstdc++ (is_lock_free() is false),
+// but only the first one keeps unrelated maps from sharing a mutex.
+
+template<class K, class V, class Compare = std::less<K>, class M = NoMeasure, class Nodes = SharedNodes>
+class AtomicRBMap
+{
+public:
+    using Map = RBMap<K, V, Compare, M, Nodes>;
+
+    AtomicRBMap() : _map(std::make_shared<const Map>()) {}
+    explicit AtomicRBMap(Map const & map) : _map(std::make_shared<const Map>(map)) {}
+    AtomicRBMap(AtomicRBMap const &) = delete;
+    AtomicRBMap & operator=(AtomicRBMap const &) = delete;
+
+    Map snapshot() const
+    {
+        return *load();
+    }
+    void store(Map const & map)
+    {
+        auto next = std::make_shared<const Map>(map);
+#if defined(__cpp_lib_atomic_shared_ptr)
+        _map.store(std::move(next));
+#else
+        std::atomic_store(&_map, std::move(next));
+#endif
+    }
+    // f: Map -> Map, must be pure: it's called again
+    // on the newer version when another writer got in first
+    // Returns the version that was published
+    template<class F>
+    Map update(F f)
+    {
+        std::shared_ptr<const Map> old = load();
+        for (;;)
+        {
+            auto next = std::make_shared<const Map>(f(*old));
+#if defined(__cpp_lib_atomic_shared_ptr)
+            if (_map.compare_exchange_weak(old, next))
+#else
+            if (std::atomic_compare_exchange_weak(&_map, &old, next))
+#endif
+                return *next;
+        }
+    }
+private:
+    std::shared_ptr<const Map> load() const
+    {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        return _map.load();
+#else
+        return std::atomic_load(&_map);
+#endif
+    }
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<std::shared_ptr<const Map>> _map;
+#else
+    std::shared_ptr<const Map> _map;
+#endif
+};
+
+#endif
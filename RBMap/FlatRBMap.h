@@ -0,0 +1,160 @@
+#if ! defined(FLATRBMAP_H)
+#define FLATRBMAP_H
+
+#include "RBMap.h"
+#include "../PureStream/Susp.h"
+#include "../Helper/FlatImage.h"
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+// Flat image of an RBMap, see Helper/FlatImage.h
+
+template<class K, class V>
+struct FlatMapNode
+{
+    K _key;
+    V _val;
+    std::int32_t _lft; // index, -1 for empty
+    std::int32_t _rgt;
+    std::int32_t _red;
+};
+
+// Read-only view of an image
+// The image must outlive the view (and all its copies)
+
+template<class K, class V, class Compare = std::less<K>>
+class FlatRBMap
+{
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "flat images need trivially copyable keys and values");
+    using Node = FlatMapNode<K, V>;
+public:
+    FlatRBMap() : _header(nullptr), _nodes(nullptr) {}
+    // Image of size bytes, e.g. an mmap'ed file
+    FlatRBMap(void const * image, std::size_t bytes)
+        : _header(flatHeader<Node>(image, bytes)), _nodes(flatNodes<Node>(image))
+    {}
+    bool isEmpty() const { return !_header || _header->_root < 0; }
+    int size() const { return _header ? _header->_count : 0; }
+    template<class Key>
+    bool member(Key const & key) const
+    {
+        return find(key) != nullptr;
+    }
+    // Pointer into the image, or nullptr if absent
+    template<class Key>
+    V const * find(Key const & key) const
+    {
+        std::int32_t i = _header ? _header->_root : -1;
+        while (i >= 0)
+        {
+            Node const & node = _nodes[i];
+            if (Compare()(key, node._key))
+                i = node._lft;
+            else if (Compare()(node._key, key))
+                i = node._rgt;
+            else
+                return &node._val;
+        }
+        return nullptr;
+    }
+    // Materialize the persistent map with the same shape and colors
+    // O(n), no comparisons or rebalancing
+    template<class M = NoMeasure, class Nodes = SharedNodes>
+    RBMap<K, V, Compare, M, Nodes> thawed() const
+    {
+        return thaw<RBMap<K, V, Compare, M, Nodes>>(_header ? _header->_root : -1);
+    }
+    // Write the image of a map
+    template<class M, class Nodes>
+    static void write(RBMap<K, V, Compare, M, Nodes> const & map, std::ostream & os)
+    {
+        std::vector<Node> nodes;
+        std::int32_t root = collect(map, nodes);
+        writeFlatImage(nodes, root, os);
+    }
+private:
+    // Pre-order, so that a left subtree is contiguous
+    template<class Map>
+    static std::int32_t collect(Map const & map, std::vector<Node> & nodes)
+    {
+        if (map.isEmpty())
+            return -1;
+        std::int32_t i = static_cast<std::int32_t>(nodes.size());
+        nodes.push_back(Node());
+        std::int32_t lft = collect(map.left(), nodes);
+        std::int32_t rgt = collect(map.right(), nodes);
+        Node & node = nodes[i];
+        node._key = map.rootKey();
+        node._val = map.rootValue();
+        node._lft = lft;
+        node._rgt = rgt;
+        node._red = map.rootColor() == R;
+        return i;
+    }
+    template<class Map>
+    Map thaw(std::int32_t i) const
+    {
+        if (i < 0)
+            return Map();
+        Node const & node = _nodes[i];
+        return Map(node._red ? R : B, thaw<Map>(node._lft), node._key, node._val, thaw<Map>(node._rgt));
+    }
+
+    FlatHeader const * _header;
+    Node const * _nodes;
+};
+
+// Snapshot loaded from an image
+// Queries go to the image until the snapshot is first modified,
+// which materializes the persistent map (once)
+
+template<class K, class V, class Compare = std::less<K>, class M = NoMeasure, class Nodes = SharedNodes>
+class MappedRBMap
+{
+public:
+    using Map = RBMap<K, V, Compare, M, Nodes>;
+
+    explicit MappedRBMap(FlatRBMap<K, V, Compare> const & flat)
+        : _flat(flat), _map([flat]()
+        {
+            return flat.template thawed<M, Nodes>();
+        })
+    {}
+    bool isEmpty() const { return _flat.isEmpty(); }
+    int size() const { return _flat.size(); }
+    template<class Key>
+    bool member(Key const & key) const { return _flat.member(key); }
+    template<class Key>
+    V const * find(Key const & key) const { return _flat.find(key); }
+    template<class Key>
+    V findWithDefault(V const & dflt, Key const & key) const
+    {
+        V const * v = find(key);
+        return v ? *v : dflt;
+    }
+    bool isThawed() const { return _map.isForced(); }
+    Map const & thawed() const { return _map.get(); }
+
+    Map inserted(K const & k, V const & v) const
+    {
+        return thawed().inserted(k, v);
+    }
+    template<class F>
+    Map insertedWith(K const & k, V const & v, F combine) const
+    {
+        return thawed().insertedWith(k, v, combine);
+    }
+    template<class F>
+    Map updated(K const & k, F f) const
+    {
+        return thawed().updated(k, f);
+    }
+private:
+    FlatRBMap<K, V, Compare> _flat;
+    Susp<Map> _map;
+};
+
+#endif
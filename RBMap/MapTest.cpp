@@ -1,8 +1,18 @@
 #include <iostream>
 #include "RBMap.h"
+#include "RBMapStream.h"
+#include "AtomicRBMap.h"
+#include "FlatRBMap.h"
+#include <sstream>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <vector>
+#include <thread>
+#include <chrono>
 
 template <typename T>
 struct ChooseNewest
@@ -14,6 +24,268 @@ struct ChooseNewest
     }
 };
 
+void testMeasure()
+{
+    RBMap<int, int, std::less<int>, SumMeasure<int>> sums;
+    RBMap<int, int, std::less<int>, CountMeasure> counts;
+    for (int i = 1; i <= 1000; ++i)
+    {
+        sums = sums.inserted(i, i);
+        counts = counts.inserted(i, i);
+    }
+    int scan = 0;
+    forEach(sums, [&scan](int k, int v)
+    {
+        if (100 <= k && k < 200)
+            scan += v;
+    });
+    std::cout << "Sum of [100, 200): " << sums.measure(100, 200) << ", scan: " << scan << std::endl;
+    std::cout << "Total: " << sums.measure() << std::endl;
+    auto updated = sums.updated(150, [](int v) { return v + 1000; });
+    std::cout << "After update: " << updated.measure(100, 200) << ", snapshot: " << sums.measure(100, 200) << std::endl;
+    std::cout << "Count of [0, 500): " << counts.measure(0, 500) << " of " << counts.measure() << std::endl;
+}
+
+void testCompact()
+{
+    RBMap<int, std::string, std::less<int>, NoMeasure, CompactNodes> map;
+    map = map.inserted(2, "two").inserted(1, "one").inserted(3, "three");
+    std::cout << map;
+    std::cout << "Bytes per node, shared: " << RBMap<int, std::string>::nodeBytes()
+        << ", compact: " << map.nodeBytes() << std::endl;
+}
+
+void testAtomic()
+{
+    AtomicRBMap<int, int> counters;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t)
+    {
+        writers.emplace_back([&counters]()
+        {
+            for (int i = 0; i < 1000; ++i)
+                counters.update([i](RBMap<int, int> const & map)
+                {
+                    return map.insertedWith(i % 10, 1, [](int a, int b) { return a + b; });
+                });
+        });
+    }
+    for (auto & w : writers)
+        w.join();
+    auto snap = counters.snapshot();
+    std::cout << "Counters after 4 x 1000 updates:\n" << snap;
+    // a lost update leaves a counter short
+    for (int k = 0; k < 10; ++k)
+    {
+        if (snap.findWithDefault(0, k) != 400)
+            std::cout << "Error: counter " << k << " is " << snap.findWithDefault(0, k) << ", not 400\n";
+    }
+}
+
+// Reloading a snapshot: re-inserting every pair
+// versus querying the image in place
+
+void testFlat(int n)
+{
+    std::vector<std::pair<int, double>> pairs;
+    for (int i = 0; i < n; ++i)
+        pairs.push_back(std::make_pair(i * 7919 % n, i * 0.5));
+    auto map = fromListOfPairs<int, double>(pairs.begin(), pairs.end());
+    std::ostringstream os;
+    FlatRBMap<int, double>::write(map, os);
+    std::string image = os.str();
+
+    auto start = std::chrono::steady_clock::now();
+    auto reloaded = fromListOfPairs<int, double>(pairs.begin(), pairs.end());
+    auto mid = std::chrono::steady_clock::now();
+    MappedRBMap<int, double> mapped(FlatRBMap<int, double>(image.data(), image.size()));
+    auto end = std::chrono::steady_clock::now();
+    std::cout << n << " pairs, " << image.size() << " bytes. Re-insert: "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(mid - start).count() << " ms, open image: "
+        << std::chrono::duration_cast<std::chrono::microseconds>(end - mid).count() << " us" << std::endl;
+
+    std::cout << "Find 42: " << *mapped.find(42) << " and " << *reloaded.find(42)
+        << ", thawed: " << mapped.isThawed() << std::endl;
+    auto modified = mapped.inserted(n, 0.0);
+    std::cout << "After insert, thawed: " << mapped.isThawed()
+        << ", size: " << n << " + " << modified.member(n) << std::endl;
+    modified.assert1();
+    modified.countB();
+
+    // Bad images throw, in release builds too
+    std::string bad[] = { image.substr(0, image.size() - 1), image, image };
+    bad[1][3] = '2'; // version
+    // the root's left child pointing back at the root
+    using Node = FlatMapNode<int, double>;
+    std::size_t lft = flatNodeOffset<Node>() + offsetof(Node, _lft);
+    std::int32_t cycle = 0;
+    std::memcpy(&bad[2][lft], &cycle, sizeof(cycle));
+    for (auto const & b : bad)
+    {
+        try
+        {
+            FlatRBMap<int, double> flat(b.data(), b.size());
+            std::cout << "Error: bad image accepted\n";
+        }
+        catch (std::runtime_error const &) {}
+    }
+}
+
+void testBulk(int n)
+{
+    // every key twice
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < n; ++i)
+        pairs.push_back(std::make_pair(static_cast<int>(i * 7919LL % (n / 2)), i));
+    auto start = std::chrono::steady_clock::now();
+    auto one = fromListOfPairs<int, int>(pairs.begin(), pairs.end());
+    auto mid = std::chrono::steady_clock::now();
+    auto bulk = bulkFromListOfPairs<int, int>(pairs.begin(), pairs.end());
+    auto end = std::chrono::steady_clock::now();
+    std::cout << n << " pairs. One by one: "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(mid - start).count() << " ms, bulk: "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(end - mid).count() << " ms" << std::endl;
+    bulk.assert1();
+    bulk.countB();
+    bool same = std::equal(std::begin(one), std::end(one), std::begin(bulk), std::end(bulk));
+    std::cout << "Same contents: " << same << std::endl;
+    auto sums = bulkFromListOfPairsWith<int, int>(pairs.begin(), pairs.end(), [](int a, int b)
+    {
+        return a + b;
+    });
+    std::cout << "Combined duplicates of 0: " << *sums.find(0) << std::endl;
+}
+
+// Readers look up keys in snapshots while one writer keeps publishing
+
+void benchAtomic(int readers)
+{
+    const int size = 100000;
+    const int lookups = 1000000;
+    RBMap<int, int> map;
+    for (int i = 0; i < size; ++i)
+        map = map.inserted(i, 0);
+    AtomicRBMap<int, int> shared(map);
+    std::atomic<bool> done(false);
+    std::thread writer([&]()
+    {
+        for (int i = 0; !done; ++i)
+            shared.update([i, size](RBMap<int, int> const & m)
+            {
+                return m.updated(i % size, [](int v) { return v + 1; });
+            });
+    });
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&shared, size, lookups]()
+        {
+            int found = 0;
+            for (int i = 0; i < lookups; )
+            {
+                auto snap = shared.snapshot();
+                for (int j = 0; j < 100; ++j, ++i)
+                    found += snap.member(static_cast<int>(i * 7919LL % size));
+            }
+            if (found != lookups)
+                std::cout << "Error: missing keys\n";
+        });
+    }
+    for (auto & t : threads)
+        t.join();
+    auto end = std::chrono::steady_clock::now();
+    done = true;
+    writer.join();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << readers << " readers: " << readers * lookups << " lookups in " << ms << " ms" << std::endl;
+}
+
+// Diff of two versions of a large map that share most of their nodes
+// Brute force check against a full merge of the two sorted sequences
+
+void testDiff(int size)
+{
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < size; ++i)
+        pairs.emplace_back(2 * i, i);
+    auto before = fromSortedPairs<int, int>(pairs.begin(), pairs.end());
+    auto after = before;
+    for (int i = 0; i < 10; ++i)
+    {
+        int k = static_cast<int>(i * 7919LL % size);
+        after = after.inserted(2 * k + 1, k);               // added
+        after = after.updated(2 * k, [](int v) { return -v; }); // changed
+    }
+    after = after.inserted(-1, 0).inserted(2 * size, 0);
+
+    int added = 0, removed = 0, changed = 0;
+    auto start = std::chrono::steady_clock::now();
+    diff(before, after
+        , [&added](int, int) { ++added; }
+        , [&removed](int, int) { ++removed; }
+        , [&changed](int, int, int) { ++changed; });
+    auto end = std::chrono::steady_clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::cout << "Diff of " << size << " entries: " << added << " added, "
+        << removed << " removed, " << changed << " changed in " << us << " us" << std::endl;
+
+    int fullAdded = 0, fullRemoved = 0, fullChanged = 0;
+    auto a = std::begin(before), b = std::begin(after);
+    while (a != std::end(before) || b != std::end(after))
+    {
+        if (b == std::end(after) || (a != std::end(before) && a.key() < b.key()))
+            ++fullRemoved, ++a;
+        else if (a == std::end(before) || b.key() < a.key())
+            ++fullAdded, ++b;
+        else
+        {
+            fullChanged += a.value() != b.value();
+            ++a, ++b;
+        }
+    }
+    if (added != fullAdded || removed != fullRemoved || changed != fullChanged)
+        std::cout << "Error: diff doesn't match full comparison\n";
+
+    // Reversed: the additions become removals
+    int removedBack = 0;
+    diff(after, before, [](int, int) {}, [&removedBack](int, int) { ++removedBack; }, [](int, int, int) {});
+    if (removedBack != added)
+        std::cout << "Error: reversed diff\n";
+
+    auto merged = mergeWith(before, after, [](int va, int vb) { return std::max(va, vb); });
+    if (merged.findWithDefault(1, -1) != 0 || merged.findWithDefault(1, 2 * size) != 0)
+        std::cout << "Error: merge lost an addition\n";
+    if (merged.findWithDefault(0, 2 * 7919) != 7919 || merged.findWithDefault(0, 2 * 7) != 7)
+        std::cout << "Error: merge didn't combine\n";
+}
+
+// Looking up string keys with std::string_view:
+// std::less<std::string> needs a std::string for every lookup,
+// std::less<> compares the view in place
+
+template<class Compare, class Key>
+void benchStringKeys(char const * label)
+{
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100000; ++i)
+        keys.push_back("/var/log/service/entry-" + std::to_string(i));
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    RBMap<std::string, int, Compare> map;
+    for (int i = 0; i < 100000; ++i)
+        map = map.inserted(keys[i], i);
+    auto start = std::chrono::steady_clock::now();
+    int found = 0;
+    for (int rep = 0; rep < 10; ++rep)
+        for (std::string_view k : views)
+            found += map.member(Key(k));
+    auto end = std::chrono::steady_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << label << ": " << found << " lookups in " << ms << " ms" << std::endl;
+    if (found != 10 * 100000)
+        std::cout << "Error: string keys not found\n";
+}
+
 int main()
 {
     RBMap<int, std::string> map;
@@ -33,5 +305,33 @@ int main()
 
     auto map4 = map.inserted(3, "three").insertedWith(3, "iii", ChooseNewest<std::string>());
     std::cout << "Use insertedWith to overwrite a value: " << map4.findWithDefault("none", 3) << std::endl;
+
+    if (std::string const * v = map1.find(7))
+        std::cout << "Found 7: " << *v << std::endl;
+    std::cout << "Found 8: " << (map1.find(8) != nullptr) << std::endl;
+    auto map5 = map1.updated(4, [](std::string const & v) { return v + "!"; });
+    std::cout << "Updated 4: " << *map5.find(4) << ", original: " << *map1.find(4) << std::endl;
+
+    for (auto it = std::begin(map1); it != std::end(map1); ++it)
+        std::cout << it.key() << ": " << it.value() << std::endl;
+    std::cout << "Lazy stream, take 2: ";
+    forEach(toStream(map1).take(2), [](std::pair<int, std::string> const & kv)
+    {
+        std::cout << kv.first << "-> " << kv.second << " ";
+    });
+    std::cout << std::endl;
+    testMeasure();
+    testCompact();
+    testAtomic();
+    testFlat(1000);
+    testFlat(1000000);
+    testBulk(1000);
+    testBulk(1000000);
+    testDiff(100000);
+    testDiff(1000000);
+    benchStringKeys<std::less<std::string>, std::string>("std::less<std::string>");
+    benchStringKeys<std::less<>, std::string_view>("std::less<>");
+    for (int readers = 1; readers <= 8; readers *= 2)
+        benchAtomic(readers);
     return 0;
 };
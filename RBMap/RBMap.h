@@ -1,5 +1,17 @@
+#if ! defined(RBMAP_H)
+#define RBMAP_H
+
+#include "../Helper/NodeLayout.h"
 #include <cassert>
 #include <memory>
+#include <functional>
+#include <vector>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <iostream> // print
 
 enum Color { R, B };
 
@@ -7,44 +19,109 @@ enum Color { R, B };
 // 2. Every path from rootKey to empty node contains the same
 // number of black nodes.
 
-template<class K, class V>
+// Measure policy: caches a monoid aggregate of every subtree in its root node
+// struct M
+// {
+//     using type = ...;
+//     static type empty();                             // identity
+//     static type measure(K const & k, V const & v);   // single entry
+//     static type combine(type const & a, type const & b); // associative
+// };
+
+// Default policy: nothing is cached
+struct NoMeasure
+{
+    struct type {};
+};
+
+// Subtree size
+struct CountMeasure
+{
+    using type = int;
+    static type empty() { return 0; }
+    template<class K, class V>
+    static type measure(K const &, V const &) { return 1; }
+    static type combine(type a, type b) { return a + b; }
+};
+
+// Sum of values
+template<class V>
+struct SumMeasure
+{
+    using type = V;
+    static type empty() { return V(); }
+    template<class K>
+    static type measure(K const &, V const & v) { return v; }
+    static type combine(type const & a, type const & b) { return a + b; }
+};
+
+template<class M>
+struct MeasureSlot
+{
+    template<class N, class K, class V>
+    void setMeasure(N const * lft, K const & k, V const & v, N const * rgt)
+    {
+        _m = M::combine(M::combine(lft ? lft->_m : M::empty(), M::measure(k, v))
+                       , rgt ? rgt->_m : M::empty());
+    }
+    typename M::type _m;
+};
+
+template<>
+struct MeasureSlot<NoMeasure>
+{
+    template<class N, class K, class V>
+    void setMeasure(N const *, K const &, V const &, N const *) {}
+};
+
+template<class K, class V, class Compare, class M, class Nodes> class RBMapIter;
+template<class K, class V, class Compare> class FlatRBMap;
+template<class K, class V, class Compare, class M, class Nodes> class RBMapCursor;
+
+// Nodes selects the node layout, see Helper/NodeLayout.h
+
+template<class K, class V, class Compare = std::less<K>, class M = NoMeasure, class Nodes = SharedNodes>
 class RBMap
 {
-    struct Node
+    struct Node : Nodes::template Links<Node>, MeasureSlot<M>
     {
+        using Links = typename Nodes::template Links<Node>;
         Node(Color c,
-            std::shared_ptr<const Node> const & lft,
-            K key, V val,
-            std::shared_ptr<const Node> const & rgt)
-            : _c(c), _lft(lft), _key(key), _val(val), _rgt(rgt)
-        {}
-        Color _c;
-        std::shared_ptr<const Node> _lft;
+            typename Links::Ptr const & lft,
+            K const & key, V const & val,
+            typename Links::Ptr const & rgt)
+            : Links(c == R, lft, rgt), _key(key), _val(val)
+        {
+            this->setMeasure(this->left(), _key, _val, this->right());
+        }
         K _key;
         V _val;
-        std::shared_ptr<const Node> _rgt;
     };
-    explicit RBMap(std::shared_ptr<const Node> const & node) : _root(node) {}
+    using NodePtr = typename Node::Links::Ptr;
+
+    explicit RBMap(NodePtr const & node) : _root(node) {}
     Color rootColor() const
     {
         assert(!isEmpty());
-        return _root->_c;
+        return _root->isRed() ? R : B;
     }
 public:
     RBMap() {}
-    RBMap(Color c, RBMap const & lft, K key, V val, RBMap const & rgt)
-        : _root(std::make_shared<const Node>(c, lft._root, key, val, rgt._root))
+    RBMap(Color c, RBMap const & lft, K const & key, V const & val, RBMap const & rgt)
+        : _root(Nodes::template make<Node>(c, lft._root, key, val, rgt._root))
     {
-        assert(lft.isEmpty() || lft.rootKey() < key);
-        assert(rgt.isEmpty() || key < rgt.rootKey());
+        assert(lft.isEmpty() || less(lft.rootKey(), key));
+        assert(rgt.isEmpty() || less(key, rgt.rootKey()));
     }
     bool isEmpty() const { return !_root; }
-    K rootKey() const
+    // References into the node, valid as long as the node
+    // is shared by a live map
+    K const & rootKey() const
     {
         assert(!isEmpty());
         return _root->_key;
     }
-    V rootValue() const
+    V const & rootValue() const
     {
         assert(!isEmpty());
         return _root->_val;
@@ -52,48 +129,98 @@ public:
     RBMap left() const
     {
         assert(!isEmpty());
-        return RBMap(_root->_lft);
+        return RBMap(_root->leftPtr());
     }
     RBMap right() const
     {
         assert(!isEmpty());
-        return RBMap(_root->_rgt);
+        return RBMap(_root->rightPtr());
     }
-    bool member(K x) const
+    bool member(K const & x) const
     {
-        if (isEmpty())
-            return false;
-        K y = rootKey();
-        if (x < y)
-            return left().member(x);
-        else if (y < x)
-            return right().member(x);
-        else
-            return true;
+        return findNode(x) != nullptr;
     }
-    V findWithDefault(V dflt, K key) const
+    // Pointer to the value stored in the node, or nullptr if absent
+    // Valid as long as the node is shared by a live map
+    V const * find(K const & key) const
     {
-        if (isEmpty())
-            return dflt;
-        K y = rootKey();
-        if (key < y)
-            return left().findWithDefault(dflt, key);
-        else if (y < key)
-            return right().findWithDefault(dflt, key);
-        else
-            return rootValue();
+        Node const * node = findNode(key);
+        return node ? &node->_val : nullptr;
+    }
+    // Heterogeneous lookup, e.g. with std::less<>:
+    // no need to convert the argument to K
+    template<class Key, class C = Compare, class = typename C::is_transparent>
+    bool member(Key const & x) const
+    {
+        return findNode(x) != nullptr;
+    }
+    template<class Key, class C = Compare, class = typename C::is_transparent>
+    V const * find(Key const & key) const
+    {
+        Node const * node = findNode(key);
+        return node ? &node->_val : nullptr;
+    }
+    template<class Key>
+    V findWithDefault(V const & dflt, Key const & key) const
+    {
+        V const * v = find(key);
+        return v ? *v : dflt;
     }
-    RBMap inserted(K x, V v) const
+    RBMap inserted(K const & x, V const & v) const
     {
         RBMap t = ins(x, v);
         return RBMap(B, t.left(), t.rootKey(), t.rootValue(), t.right());
     }
     template<class F>
-    RBMap insertedWith(K k, V v, F combine) const
+    RBMap insertedWith(K const & k, V const & v, F combine) const
     {
         RBMap t = insWith(k, v, combine);
         return RBMap(B, t.left(), t.rootKey(), t.rootValue(), t.right());
     }
+    // Aggregate of all entries, O(1)
+    typename M::type measure() const
+    {
+        return isEmpty() ? M::empty() : _root->_m;
+    }
+    // Aggregate of the entries with lo <= key < hi, O(log n)
+    typename M::type measure(K const & lo, K const & hi) const
+    {
+        if (isEmpty())
+            return M::empty();
+        K const & y = _root->_key;
+        if (less(y, lo))
+            return right().measure(lo, hi);
+        if (!less(y, hi))
+            return left().measure(lo, hi);
+        return M::combine(M::combine(left().measureFrom(lo), M::measure(y, _root->_val))
+                         , right().measureBelow(hi));
+    }
+    // Replace the value at key with f(value) in a single path copy
+    // The shape and colors don't change, so no rebalancing
+    // Returns the same map if the key is absent
+    template<class F>
+    RBMap updated(K const & key, F f) const
+    {
+        if (isEmpty())
+            return *this;
+        K const & y = _root->_key;
+        if (less(key, y))
+        {
+            RBMap lft = left().updated(key, f);
+            if (lft._root.get() == _root->left())
+                return *this;
+            return RBMap(rootColor(), lft, y, _root->_val, right());
+        }
+        else if (less(y, key))
+        {
+            RBMap rgt = right().updated(key, f);
+            if (rgt._root.get() == _root->right())
+                return *this;
+            return RBMap(rootColor(), left(), y, _root->_val, rgt);
+        }
+        else
+            return RBMap(rootColor(), left(), y, f(_root->_val), right());
+    }
     // 1. No red node has a red child.
     void assert1() const
     {
@@ -121,64 +248,111 @@ public:
         assert(lft == rgt);
         return (rootColor() == B) ? 1 + lft : lft;
     }
+    // For benchmarking
+    static std::size_t nodeBytes() { return Nodes::template nodeBytes<Node>(); }
+
+    friend class RBMapIter<K, V, Compare, M, Nodes>;
+    friend class FlatRBMap<K, V, Compare>;
+    friend class RBMapCursor<K, V, Compare, M, Nodes>;
 private:
-    RBMap ins(K x, V v) const
+    // Compare is stateless: it's default-constructed for each comparison
+    template<class A, class C>
+    static bool less(A const & a, C const & b)
+    {
+        return Compare()(a, b);
+    }
+    template<class Key>
+    Node const * findNode(Key const & key) const
+    {
+        Node const * node = _root.get();
+        while (node)
+        {
+            if (less(key, node->_key))
+                node = node->left();
+            else if (less(node->_key, key))
+                node = node->right();
+            else
+                return node;
+        }
+        return nullptr;
+    }
+    // Aggregate of the entries with lo <= key
+    typename M::type measureFrom(K const & lo) const
+    {
+        if (isEmpty())
+            return M::empty();
+        K const & y = _root->_key;
+        if (less(y, lo))
+            return right().measureFrom(lo);
+        return M::combine(M::combine(left().measureFrom(lo), M::measure(y, _root->_val))
+                         , right().measure());
+    }
+    // Aggregate of the entries with key < hi
+    typename M::type measureBelow(K const & hi) const
+    {
+        if (isEmpty())
+            return M::empty();
+        K const & y = _root->_key;
+        if (!less(y, hi))
+            return left().measureBelow(hi);
+        return M::combine(M::combine(left().measure(), M::measure(y, _root->_val))
+                         , right().measureBelow(hi));
+    }
+    RBMap ins(K const & x, V const & v) const
     {
-        assert1();
         if (isEmpty())
             return RBMap(R, RBMap(), x, v, RBMap());
-        K y = rootKey();
-        V yv = rootValue();
+        K const & y = _root->_key;
+        V const & yv = _root->_val;
         Color c = rootColor();
         if (rootColor() == B)
         {
-            if (x < y)
+            if (less(x, y))
                 return balance(left().ins(x, v), y, yv, right());
-            else if (y < x)
+            else if (less(y, x))
                 return balance(left(), y, yv, right().ins(x, v));
             else
                 return *this; // no duplicates
         }
         else
         {
-            if (x < y)
+            if (less(x, y))
                 return RBMap(c, left().ins(x, v), y, yv, right());
-            else if (y < x)
+            else if (less(y, x))
                 return RBMap(c, left(), y, yv, right().ins(x, v));
             else
                 return *this; // no duplicates
         }
     }
     template<class F>
-    RBMap insWith(K x, V v, F combine) const
+    RBMap insWith(K const & x, V const & v, F combine) const
     {
-        assert1();
         if (isEmpty())
             return RBMap(R, RBMap(), x, v, RBMap());
-        K y = rootKey();
-        V yv = rootValue();
+        K const & y = _root->_key;
+        V const & yv = _root->_val;
         Color c = rootColor();
         if (rootColor() == B)
         {
-            if (x < y)
+            if (less(x, y))
                 return balance(left().insWith(x, v, combine), y, yv, right());
-            else if (y < x)
+            else if (less(y, x))
                 return balance(left(), y, yv, right().insWith(x, v, combine));
             else
                 return RBMap(c, left(), y, combine(yv, v), right());
         }
         else
         {
-            if (x < y)
+            if (less(x, y))
                 return RBMap(c, left().insWith(x, v, combine), y, yv, right());
-            else if (y < x)
+            else if (less(y, x))
                 return RBMap(c, left(), y, yv, right().insWith(x, v, combine));
             else
                 return RBMap(c, left(), y, combine(yv, v), right());
         }
     }
     // Called only when parent is black
-    static RBMap balance(RBMap const & lft, K x, V v, RBMap const & rgt)
+    static RBMap balance(RBMap const & lft, K const & x, V const & v, RBMap const & rgt)
     {
         if (lft.doubledLeft())
             return RBMap(R
@@ -227,11 +401,235 @@ private:
         return RBMap(c, left(), rootKey(), rootValue(), right());
     }
 private:
-    std::shared_ptr<const Node> _root;
+    NodePtr _root;
+};
+
+// In-order iterator with an explicit stack of raw node pointers
+// The map must outlive the iterator
+
+template<class K, class V, class Compare, class M, class Nodes>
+class RBMapIter : public std::iterator<std::forward_iterator_tag, std::pair<K, V>>
+{
+    using Node = typename RBMap<K, V, Compare, M, Nodes>::Node;
+public:
+    RBMapIter() {} // end
+    explicit RBMapIter(RBMap<K, V, Compare, M, Nodes> const & t)
+    {
+        pushLeft(t._root.get());
+    }
+    std::pair<K, V> operator*() const
+    {
+        return std::make_pair(key(), value());
+    }
+    K const & key() const { return _stack.back()->_key; }
+    V const & value() const { return _stack.back()->_val; }
+    RBMapIter & operator++()
+    {
+        Node const * node = _stack.back();
+        _stack.pop_back();
+        pushLeft(node->right());
+        return *this;
+    }
+    bool operator==(RBMapIter const & other) const
+    {
+        if (_stack.empty() || other._stack.empty())
+            return _stack.empty() && other._stack.empty();
+        return _stack.back() == other._stack.back();
+    }
+    bool operator!=(RBMapIter const & other) const
+    {
+        return !(*this == other);
+    }
+private:
+    void pushLeft(Node const * node)
+    {
+        while (node)
+        {
+            _stack.push_back(node);
+            node = node->left();
+        }
+    }
+    std::vector<Node const *> _stack;
+};
+
+namespace std
+{
+    template<class K, class V, class Compare, class M, class Nodes>
+    RBMapIter<K, V, Compare, M, Nodes> begin(RBMap<K, V, Compare, M, Nodes> const & t)
+    {
+        return RBMapIter<K, V, Compare, M, Nodes>(t);
+    }
+    template<class K, class V, class Compare, class M, class Nodes>
+    RBMapIter<K, V, Compare, M, Nodes> end(RBMap<K, V, Compare, M, Nodes> const &)
+    {
+        return RBMapIter<K, V, Compare, M, Nodes>();
+    }
+}
+
+// In-order walk that doesn't expand a subtree until asked to,
+// so that subtrees shared between two maps can be skipped whole.
+// Every item on the stack is either a subtree or a single entry.
+// Subtrees carry a rank that strictly decreases from parent to child:
+// twice the black height, plus one for a red node.
+
+template<class K, class V, class Compare, class M, class Nodes>
+class RBMapCursor
+{
+    using Node = typename RBMap<K, V, Compare, M, Nodes>::Node;
+    struct Item
+    {
+        Node const * _node;
+        int _bh;       // black height of the subtree, if not an entry
+        bool _isEntry;
+    };
+public:
+    explicit RBMapCursor(RBMap<K, V, Compare, M, Nodes> const & t)
+    {
+        int bh = 0;
+        for (Node const * node = t._root.get(); node; node = node->left())
+        {
+            if (!node->isRed())
+                ++bh;
+        }
+        pushSubtree(t._root.get(), bh);
+    }
+    bool isDone() const { return _stack.empty(); }
+    bool isEntry() const { return _stack.back()._isEntry; }
+    // Identity of the subtree on top
+    void const * subtree() const { return _stack.back()._node; }
+    int rank() const
+    {
+        Item const & item = _stack.back();
+        return 2 * item._bh + (item._node->isRed() ? 1 : 0);
+    }
+    K const & key() const { return _stack.back()._node->_key; }
+    V const & value() const { return _stack.back()._node->_val; }
+    // Replace the subtree on top with its left subtree, root entry, right subtree
+    void expand()
+    {
+        Item item = _stack.back();
+        _stack.pop_back();
+        int bh = item._node->isRed() ? item._bh : item._bh - 1;
+        pushSubtree(item._node->right(), bh);
+        _stack.push_back(Item{ item._node, 0, true });
+        pushSubtree(item._node->left(), bh);
+    }
+    // Drop the entry or the whole subtree on top
+    void pop() { _stack.pop_back(); }
+    // Visit every entry of the subtree (or the entry) on top, then drop it
+    template<class F>
+    void popAll(F f)
+    {
+        Item item = _stack.back();
+        _stack.pop_back();
+        if (item._isEntry)
+            f(item._node->_key, item._node->_val);
+        else
+            forEachIn(item._node, f);
+    }
+private:
+    template<class F>
+    static void forEachIn(Node const * node, F & f)
+    {
+        if (node)
+        {
+            forEachIn(node->left(), f);
+            f(node->_key, node->_val);
+            forEachIn(node->right(), f);
+        }
+    }
+    void pushSubtree(Node const * node, int bh)
+    {
+        if (node)
+            _stack.push_back(Item{ node, bh, false });
+    }
+    std::vector<Item> _stack;
 };
 
-template<class K, class V, class F>
-void forEach(RBMap<K, V> const & t, F f) {
+// Report the differences between two versions of a map:
+// onAdd(k, v) for keys only in b, onRemove(k, v) for keys only in a,
+// onChange(k, va, vb) for keys whose values differ (V needs ==).
+// Subtrees shared by a and b are skipped, so the cost is proportional
+// to the size of the change rather than to the size of the maps.
+
+template<class K, class V, class Compare, class M, class Nodes, class Add, class Remove, class Change>
+void diff(RBMap<K, V, Compare, M, Nodes> const & a
+        , RBMap<K, V, Compare, M, Nodes> const & b
+        , Add onAdd, Remove onRemove, Change onChange)
+{
+    RBMapCursor<K, V, Compare, M, Nodes> ca(a);
+    RBMapCursor<K, V, Compare, M, Nodes> cb(b);
+    while (!ca.isDone() && !cb.isDone())
+    {
+        if (!ca.isEntry() && !cb.isEntry())
+        {
+            if (ca.subtree() == cb.subtree())
+            {
+                ca.pop();
+                cb.pop();
+            }
+            else if (ca.rank() >= cb.rank())
+                ca.expand();
+            else
+                cb.expand();
+        }
+        else if (!ca.isEntry())
+            ca.expand();
+        else if (!cb.isEntry())
+            cb.expand();
+        else if (Compare()(ca.key(), cb.key()))
+        {
+            onRemove(ca.key(), ca.value());
+            ca.pop();
+        }
+        else if (Compare()(cb.key(), ca.key()))
+        {
+            onAdd(cb.key(), cb.value());
+            cb.pop();
+        }
+        else
+        {
+            if (ca.subtree() != cb.subtree() && !(ca.value() == cb.value()))
+                onChange(ca.key(), ca.value(), cb.value());
+            ca.pop();
+            cb.pop();
+        }
+    }
+    while (!ca.isDone())
+        ca.popAll(onRemove);
+    while (!cb.isDone())
+        cb.popAll(onAdd);
+}
+
+// Union of two maps; for keys in both, the value is f(va, vb).
+// f(v, v) must be v (e.g. pick one side), so that entries
+// shared by a and b can be skipped: the cost is proportional
+// to the difference between the maps.
+
+template<class K, class V, class Compare, class M, class Nodes, class F>
+RBMap<K, V, Compare, M, Nodes> mergeWith(RBMap<K, V, Compare, M, Nodes> const & a
+                                       , RBMap<K, V, Compare, M, Nodes> const & b
+                                       , F f)
+{
+    RBMap<K, V, Compare, M, Nodes> res = a;
+    diff(a, b
+        , [&res](K const & k, V const & v)
+        {
+            res = res.inserted(k, v);
+        }
+        , [](K const &, V const &) {}
+        , [&res, &f](K const & k, V const &, V const & vb)
+        {
+            res = res.updated(k, [&f, &vb](V const & va)
+            {
+                return f(va, vb);
+            });
+        });
+    return res;
+}
+
+template<class K, class V, class Compare, class M, class Nodes, class F>
+void forEach(RBMap<K, V, Compare, M, Nodes> const & t, F f) {
     if (!t.isEmpty()) {
         forEach(t.left(), f);
         f(t.rootKey(), t.rootValue());
@@ -239,17 +637,120 @@ void forEach(RBMap<K, V> const & t, F f) {
     }
 }
 
-template<class K, class V, class I>
-RBMap<K, V> fromListOfPairs(I beg, I end)
+template<class K, class V, class Compare = std::less<K>, class M = NoMeasure, class Nodes = SharedNodes, class I>
+RBMap<K, V, Compare, M, Nodes> fromListOfPairs(I beg, I end)
 {
-    RBMap<K, V> map;
+    RBMap<K, V, Compare, M, Nodes> map;
     for (auto it = beg; it != end; ++it)
         map = map.inserted(it->first, it->second);
     return map;
 }
 
-template<class K, class V>
-void print(RBMap<K, V> const & map)
+// Bulk construction: sort, then build bottom-up in O(n)
+// Subproblems larger than this go to separate threads
+const int bulkCutoff = 10000;
+
+// Stable, so that duplicates keep their input order
+template<class It, class Less>
+void parallelSort(It b, It e, Less less, int parDepth)
+{
+    if (parDepth <= 0 || e - b < bulkCutoff)
+    {
+        std::stable_sort(b, e, less);
+        return;
+    }
+    It mid = b + (e - b) / 2;
+    auto fut = std::async(std::launch::async, [=]()
+    {
+        parallelSort(b, mid, less, parDepth - 1);
+    });
+    parallelSort(mid, e, less, parDepth - 1);
+    fut.wait();
+    std::inplace_merge(b, mid, e, less);
+}
+
+// Splitting at the middle, all empty subtrees are at depth
+// redDepth or redDepth + 1, and levels above redDepth are full.
+// Painting the (partial) level redDepth red balances the tree.
+template<class Map, class It>
+Map buildSorted(It b, int n, int depth, int redDepth, int parDepth)
+{
+    if (n == 0)
+        return Map();
+    int mid = n / 2;
+    Map lft;
+    Map rgt;
+    if (parDepth > 0 && n > bulkCutoff)
+    {
+        auto fut = std::async(std::launch::async, [=]()
+        {
+            return buildSorted<Map>(b, mid, depth + 1, redDepth, parDepth - 1);
+        });
+        rgt = buildSorted<Map>(b + mid + 1, n - mid - 1, depth + 1, redDepth, parDepth - 1);
+        lft = fut.get();
+    }
+    else
+    {
+        lft = buildSorted<Map>(b, mid, depth + 1, redDepth, 0);
+        rgt = buildSorted<Map>(b + mid + 1, n - mid - 1, depth + 1, redDepth, 0);
+    }
+    return Map(depth == redDepth ? R : B, lft, b[mid].first, b[mid].second, rgt);
+}
+
+inline int parallelDepth()
+{
+    int depth = 0;
+    for (unsigned n = std::thread::hardware_concurrency(); n > 1; n /= 2)
+        ++depth;
+    return depth;
+}
+
+// From a random-access range of pairs with strictly increasing keys
+template<class K, class V, class Compare = std::less<K>, class M = NoMeasure, class Nodes = SharedNodes, class I>
+RBMap<K, V, Compare, M, Nodes> fromSortedPairs(I beg, I end)
+{
+    int n = static_cast<int>(end - beg);
+    int redDepth = 0;
+    while ((2 << redDepth) - 1 <= n)
+        ++redDepth;
+    return buildSorted<RBMap<K, V, Compare, M, Nodes>>(beg, n, 0, redDepth, parallelDepth());
+}
+
+// Duplicate keys are resolved with combine(earlier, later),
+// as in insertedWith
+template<class K, class V, class Compare = std::less<K>, class M = NoMeasure, class Nodes = SharedNodes, class I, class F>
+RBMap<K, V, Compare, M, Nodes> bulkFromListOfPairsWith(I beg, I end, F combine)
+{
+    std::vector<std::pair<K, V>> pairs(beg, end);
+    parallelSort(pairs.begin(), pairs.end(), [](std::pair<K, V> const & a, std::pair<K, V> const & b)
+    {
+        return Compare()(a.first, b.first);
+    }, parallelDepth());
+    // merge runs of equal keys
+    auto out = pairs.begin();
+    for (auto it = pairs.begin(); it != pairs.end(); ++it)
+    {
+        if (out != pairs.begin() && !Compare()((out - 1)->first, it->first))
+            (out - 1)->second = combine((out - 1)->second, it->second);
+        else
+            *out++ = *it;
+    }
+    pairs.erase(out, pairs.end());
+    return fromSortedPairs<K, V, Compare, M, Nodes>(pairs.begin(), pairs.end());
+}
+
+// Like fromListOfPairs: the first of duplicate keys wins
+template<class K, class V, class Compare = std::less<K>, class M = NoMeasure, class Nodes = SharedNodes, class I>
+RBMap<K, V, Compare, M, Nodes> bulkFromListOfPairs(I beg, I end)
+{
+    return bulkFromListOfPairsWith<K, V, Compare, M, Nodes>(beg, end, [](V const & first, V const &)
+    {
+        return first;
+    });
+}
+
+template<class K, class V, class Compare, class M, class Nodes>
+void print(RBMap<K, V, Compare, M, Nodes> const & map)
 {
     forEach(map, [](K k, V v) {
         std::cout << k << "-> " << v << std::endl;
@@ -257,8 +758,8 @@ void print(RBMap<K, V> const & map)
     std::cout << std::endl;
 }
 
-template<class K, class V>
-std::ostream& operator<<(std::ostream& os, RBMap<K, V> const & map)
+template<class K, class V, class Compare, class M, class Nodes>
+std::ostream& operator<<(std::ostream& os, RBMap<K, V, Compare, M, Nodes> const & map)
 {
     forEach(map, [&os](K k, V v) {
         os << k << "-> " << v << std::endl;
@@ -267,3 +768,4 @@ std::ostream& operator<<(std::ostream& os, RBMap<K, V> const & map)
     return os;
 }
 
+#endif
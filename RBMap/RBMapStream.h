@@ -0,0 +1,32 @@
+#if ! defined(RBMAPSTREAM_H)
+#define RBMAPSTREAM_H
+
+#include "RBMap.h"
+#include "../PureStream/PureStream.h"
+#include <utility>
+
+// Lazy streams over an RBMap, kept apart so that
+// map users don't pull in the stream headers
+
+template<class K, class V, class Compare, class M, class Nodes>
+Stream<std::pair<K, V>> streamFrom(RBMap<K, V, Compare, M, Nodes> const & t, RBMapIter<K, V, Compare, M, Nodes> it)
+{
+    if (it == std::end(t))
+        return Stream<std::pair<K, V>>();
+    // the closure keeps the map alive for the iterator
+    return Stream<std::pair<K, V>>([t, it]()
+    {
+        auto next = it;
+        auto kv = *next;
+        return Cell<std::pair<K, V>>(kv, streamFrom(t, ++next));
+    });
+}
+
+// Lazy in-order stream of key-value pairs
+template<class K, class V, class Compare, class M, class Nodes>
+Stream<std::pair<K, V>> toStream(RBMap<K, V, Compare, M, Nodes> const & t)
+{
+    return streamFrom(t, std::begin(t));
+}
+
+#endif
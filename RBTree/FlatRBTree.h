@@ -0,0 +1,132 @@
+#if ! defined(FLATRBTREE_H)
+#define FLATRBTREE_H
+
+#include "RBTree.h"
+#include "../PureStream/Susp.h"
+#include "../Helper/FlatImage.h"
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+// Flat image of an RBTree, see Helper/FlatImage.h
+
+template<class T>
+struct FlatSetNode
+{
+    T _val;
+    std::int32_t _lft; // index, -1 for empty
+    std::int32_t _rgt;
+    std::int32_t _red;
+};
+
+// Read-only view of an image
+// The image must outlive the view (and all its copies)
+
+template<class T, class Compare = std::less<T>>
+class FlatRBTree
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+        "flat images need trivially copyable elements");
+    using Node = FlatSetNode<T>;
+public:
+    FlatRBTree() : _header(nullptr), _nodes(nullptr) {}
+    // Image of size bytes, e.g. an mmap'ed file
+    FlatRBTree(void const * image, std::size_t bytes)
+        : _header(flatHeader<Node>(image, bytes)), _nodes(flatNodes<Node>(image))
+    {}
+    bool isEmpty() const { return !_header || _header->_root < 0; }
+    int size() const { return _header ? _header->_count : 0; }
+    template<class Key>
+    bool member(Key const & x) const
+    {
+        std::int32_t i = _header ? _header->_root : -1;
+        while (i >= 0)
+        {
+            Node const & node = _nodes[i];
+            if (Compare()(x, node._val))
+                i = node._lft;
+            else if (Compare()(node._val, x))
+                i = node._rgt;
+            else
+                return true;
+        }
+        return false;
+    }
+    // Materialize the persistent tree with the same shape and colors
+    template<class Nodes = SharedNodes>
+    RBTree<T, Compare, Nodes> thawed() const
+    {
+        return thaw<RBTree<T, Compare, Nodes>>(_header ? _header->_root : -1);
+    }
+    // Write the image of a tree
+    template<class Nodes>
+    static void write(RBTree<T, Compare, Nodes> const & t, std::ostream & os)
+    {
+        std::vector<Node> nodes;
+        std::int32_t root = collect(t, nodes);
+        writeFlatImage(nodes, root, os);
+    }
+private:
+    template<class Tree>
+    static std::int32_t collect(Tree const & t, std::vector<Node> & nodes)
+    {
+        if (t.isEmpty())
+            return -1;
+        std::int32_t i = static_cast<std::int32_t>(nodes.size());
+        nodes.push_back(Node());
+        std::int32_t lft = collect(t.left(), nodes);
+        std::int32_t rgt = collect(t.right(), nodes);
+        Node & node = nodes[i];
+        node._val = t.root();
+        node._lft = lft;
+        node._rgt = rgt;
+        node._red = t.rootColor() == Tree::R;
+        return i;
+    }
+    template<class Tree>
+    Tree thaw(std::int32_t i) const
+    {
+        if (i < 0)
+            return Tree();
+        Node const & node = _nodes[i];
+        return Tree(node._red ? Tree::R : Tree::B, thaw<Tree>(node._lft), node._val, thaw<Tree>(node._rgt));
+    }
+
+    FlatHeader const * _header;
+    Node const * _nodes;
+};
+
+// Snapshot loaded from an image
+// Queries go to the image until the snapshot is first modified,
+// which materializes the persistent tree (once)
+
+template<class T, class Compare = std::less<T>, class Nodes = SharedNodes>
+class MappedRBTree
+{
+public:
+    using Tree = RBTree<T, Compare, Nodes>;
+
+    explicit MappedRBTree(FlatRBTree<T, Compare> const & flat)
+        : _flat(flat), _tree([flat]()
+        {
+            return flat.template thawed<Nodes>();
+        })
+    {}
+    bool isEmpty() const { return _flat.isEmpty(); }
+    int size() const { return _flat.size(); }
+    template<class Key>
+    bool member(Key const & x) const { return _flat.member(x); }
+    bool isThawed() const { return _tree.isForced(); }
+    Tree const & thawed() const { return _tree.get(); }
+
+    Tree inserted(T const & x) const
+    {
+        return thawed().inserted(x);
+    }
+private:
+    FlatRBTree<T, Compare> _flat;
+    Susp<Tree> _tree;
+};
+
+#endif
@@ -1,42 +1,54 @@
+#if ! defined(RBTREE_H)
+#define RBTREE_H
+
 #include "../List/List.h"
+#include "../Helper/NodeLayout.h"
 #include <cassert>
 #include <memory>
+#include <functional>
+#include <vector>
+#include <iterator>
+
+template<class T, class Compare, class Nodes> class RBTreeIter;
+template<class T, class Compare> class FlatRBTree;
 
 // 1. No red node has a red child.
 // 2. Every path from root to empty node contains the same
 // number of black nodes.
 
-template<class T>
+// Nodes selects the node layout, see Helper/NodeLayout.h
+
+template<class T, class Compare = std::less<T>, class Nodes = SharedNodes>
 class RBTree
 {
     enum Color { R, B };
 
-    struct Node
+    struct Node : Nodes::template Links<Node>
     {
+        using Links = typename Nodes::template Links<Node>;
         Node(Color c, 
-            std::shared_ptr<const Node> const & lft, 
-            T val, 
-            std::shared_ptr<const Node> const & rgt)
-            : _c(c), _lft(lft), _val(val), _rgt(rgt)
+            typename Links::Ptr const & lft, 
+            T const & val, 
+            typename Links::Ptr const & rgt)
+            : Links(c == R, lft, rgt), _val(val)
         {}
-        Color _c;
-        std::shared_ptr<const Node> _lft;
         T _val;
-        std::shared_ptr<const Node> _rgt;
     };
-    explicit RBTree(std::shared_ptr<const Node> const & node) : _root(node) {} 
+    using NodePtr = typename Node::Links::Ptr;
+
+    explicit RBTree(NodePtr const & node) : _root(node) {} 
     Color rootColor() const
     {
         assert (!isEmpty());
-        return _root->_c;
+        return _root->isRed() ? R : B;
     }
 public:
     RBTree() {}
-    RBTree(Color c, RBTree const & lft, T val, RBTree const & rgt)
-        : _root(std::make_shared<const Node>(c, lft._root, val, rgt._root))
+    RBTree(Color c, RBTree const & lft, T const & val, RBTree const & rgt)
+        : _root(Nodes::template make<Node>(c, lft._root, val, rgt._root))
     {
-        assert(lft.isEmpty() || lft.root() < val);
-        assert(rgt.isEmpty() || val < rgt.root());
+        assert(lft.isEmpty() || less(lft.root(), val));
+        assert(rgt.isEmpty() || less(val, rgt.root()));
     }
     RBTree(std::initializer_list<T> init)
     {
@@ -57,7 +69,9 @@ public:
         _root = t._root;
     }
     bool isEmpty() const { return !_root; }
-    T root() const
+    // Reference into the node, valid as long as the node
+    // is shared by a live tree
+    T const & root() const
     {
         assert(!isEmpty());
         return _root->_val;
@@ -65,26 +79,25 @@ public:
     RBTree left() const
     {
         assert(!isEmpty());
-        return RBTree(_root->_lft);
+        return RBTree(_root->leftPtr());
     }
     RBTree right() const
     {
         assert(!isEmpty());
-        return RBTree(_root->_rgt);
+        return RBTree(_root->rightPtr());
     }
-    bool member(T x) const
+    bool member(T const & x) const
     {
-        if (isEmpty())
-            return false;
-        T y = root();
-        if (x < y)
-            return left().member(x);
-        else if (y < x)
-            return right().member(x);
-        else
-            return true;
+        return findNode(x) != nullptr;
     }
-    RBTree inserted(T x) const
+    // Heterogeneous lookup, e.g. with std::less<>:
+    // no need to convert the argument to T
+    template<class Key, class C = Compare, class = typename C::is_transparent>
+    bool member(Key const & x) const
+    {
+        return findNode(x) != nullptr;
+    }
+    RBTree inserted(T const & x) const
     {
         RBTree t = ins(x);
         return RBTree(B, t.left(), t.root(), t.right());
@@ -116,35 +129,60 @@ public:
         assert(lft == rgt);
         return (rootColor() == B)? 1 + lft: lft;
     }
+    // For benchmarking
+    static std::size_t nodeBytes() { return Nodes::template nodeBytes<Node>(); }
+
+    friend class RBTreeIter<T, Compare, Nodes>;
+    friend class FlatRBTree<T, Compare>;
 private:
-    RBTree ins(T x) const
+    // Compare is stateless: it's default-constructed for each comparison
+    template<class A, class C>
+    static bool less(A const & a, C const & b)
+    {
+        return Compare()(a, b);
+    }
+    template<class Key>
+    Node const * findNode(Key const & x) const
+    {
+        Node const * node = _root.get();
+        while (node)
+        {
+            if (less(x, node->_val))
+                node = node->left();
+            else if (less(node->_val, x))
+                node = node->right();
+            else
+                return node;
+        }
+        return nullptr;
+    }
+    RBTree ins(T const & x) const
     {
-        assert1();
         if (isEmpty())
             return RBTree(R, RBTree(), x, RBTree());
-        T y = root();
+        T const & y = _root->_val;
         Color c = rootColor();
         if (rootColor() == B)
         {
-            if (x < y)
+            if (less(x, y))
                 return balance(left().ins(x), y, right());
-            else if (y < x)
+            else if (less(y, x))
                 return balance(left(), y, right().ins(x));
             else
                 return *this; // no duplicates
         }
         else
         {
-            if (x < y)
+            if (less(x, y))
                 return RBTree(c, left().ins(x), y, right());
-            else if (y < x)
+            else if (less(y, x))
                 return RBTree(c, left(), y, right().ins(x));
             else
                 return *this; // no duplicates
         }
     }
     // Called only when parent is black
-    static RBTree balance(RBTree const & lft, T x, RBTree const & rgt)
+    static RBTree balance(RBTree const & lft, T const & x, RBTree const & rgt)
     {
         if (lft.doubledLeft())
             return RBTree(R
@@ -189,11 +227,68 @@ private:
         return RBTree(c, left(), root(), right());
     }
 private:
-    std::shared_ptr<const Node> _root;
+    NodePtr _root;
 };
 
-template<class T, class F>
-void forEach(RBTree<T> const & t, F f) {
+// In-order iterator with an explicit stack of raw node pointers
+// The tree must outlive the iterator
+
+template<class T, class Compare, class Nodes>
+class RBTreeIter : public std::iterator<std::forward_iterator_tag, T>
+{
+    using Node = typename RBTree<T, Compare, Nodes>::Node;
+public:
+    RBTreeIter() {} // end
+    explicit RBTreeIter(RBTree<T, Compare, Nodes> const & t)
+    {
+        pushLeft(t._root.get());
+    }
+    T operator*() const { return _stack.back()->_val; }
+    RBTreeIter & operator++()
+    {
+        Node const * node = _stack.back();
+        _stack.pop_back();
+        pushLeft(node->right());
+        return *this;
+    }
+    bool operator==(RBTreeIter const & other) const
+    {
+        if (_stack.empty() || other._stack.empty())
+            return _stack.empty() && other._stack.empty();
+        return _stack.back() == other._stack.back();
+    }
+    bool operator!=(RBTreeIter const & other) const
+    {
+        return !(*this == other);
+    }
+private:
+    void pushLeft(Node const * node)
+    {
+        while (node)
+        {
+            _stack.push_back(node);
+            node = node->left();
+        }
+    }
+    std::vector<Node const *> _stack;
+};
+
+namespace std
+{
+    template<class T, class Compare, class Nodes>
+    RBTreeIter<T, Compare, Nodes> begin(RBTree<T, Compare, Nodes> const & t)
+    {
+        return RBTreeIter<T, Compare, Nodes>(t);
+    }
+    template<class T, class Compare, class Nodes>
+    RBTreeIter<T, Compare, Nodes> end(RBTree<T, Compare, Nodes> const &)
+    {
+        return RBTreeIter<T, Compare, Nodes>();
+    }
+}
+
+template<class T, class Compare, class Nodes, class F>
+void forEach(RBTree<T, Compare, Nodes> const & t, F f) {
     if (!t.isEmpty()) {
         forEach(t.left(), f);
         f(t.root());
@@ -201,8 +296,8 @@ void forEach(RBTree<T> const & t, F f) {
     }
 }
 
-template<class T, class Beg, class End>
-RBTree<T> inserted(RBTree<T> t, Beg it, End end)
+template<class T, class Compare, class Nodes, class Beg, class End>
+RBTree<T, Compare, Nodes> inserted(RBTree<T, Compare, Nodes> t, Beg it, End end)
 {
     if (it == end)
         return t;
@@ -211,11 +306,11 @@ RBTree<T> inserted(RBTree<T> t, Beg it, End end)
     return t1.inserted(item);
 }
 
-template<class T>
-RBTree<T> treeUnion(RBTree<T> const & a, RBTree<T> const & b)
+template<class T, class Compare = std::less<T>, class Nodes = SharedNodes>
+RBTree<T, Compare, Nodes> treeUnion(RBTree<T, Compare, Nodes> const & a, RBTree<T, Compare, Nodes> const & b)
 {
     // a u b = a + (b \ a)
-    RBTree<T> res = a;
+    RBTree<T, Compare, Nodes> res = a;
     forEach(b, [&res, &a](T const & v){
         if (!a.member(v))
             res.inserted(v);
@@ -224,8 +319,8 @@ RBTree<T> treeUnion(RBTree<T> const & a, RBTree<T> const & b)
 }
 
 // Remove elements in set from a list
-template<class T>
-List<T> rem_from_list(List<T> const & lst, RBTree<T> const & set)
+template<class T, class Compare, class Nodes>
+List<T> rem_from_list(List<T> const & lst, RBTree<T, Compare, Nodes> const & set)
 {
     List<T> res;
     lst.forEach([&res, &set](T const & v) {
@@ -235,5 +330,4 @@ List<T> rem_from_list(List<T> const & lst, RBTree<T> const & set)
     return res;
 }
 
-
-
+#endif
@@ -0,0 +1,31 @@
+#if ! defined(RBTREESTREAM_H)
+#define RBTREESTREAM_H
+
+#include "RBTree.h"
+#include "../PureStream/PureStream.h"
+
+// Lazy streams over an RBTree, kept apart so that
+// tree users don't pull in the stream headers
+
+template<class T, class Compare, class Nodes>
+Stream<T> streamFrom(RBTree<T, Compare, Nodes> const & t, RBTreeIter<T, Compare, Nodes> it)
+{
+    if (it == std::end(t))
+        return Stream<T>();
+    // the closure keeps the tree alive for the iterator
+    return Stream<T>([t, it]()
+    {
+        auto next = it;
+        T v = *next;
+        return Cell<T>(v, streamFrom(t, ++next));
+    });
+}
+
+// Lazy in-order stream of elements
+template<class T, class Compare, class Nodes>
+Stream<T> toStream(RBTree<T, Compare, Nodes> const & t)
+{
+    return streamFrom(t, std::begin(t));
+}
+
+#endif
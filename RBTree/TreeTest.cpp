@@ -1,10 +1,17 @@
 #include "RBTree.h"
+#include "RBTreeStream.h"
+#include "FlatRBTree.h"
+#include <sstream>
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <vector>
+#include <numeric>
+#include <random>
+#include <chrono>
 
-template<class T>
-void print(RBTree<T> const & t)
+template<class T, class Compare, class Nodes>
+void print(RBTree<T, Compare, Nodes> const & t)
 {
     forEach(t, [](T v)
     {
@@ -19,10 +26,100 @@ void testInit()
     print(t);
 }
 
+void testIter()
+{
+    RBTree<int> a{ 50, 40, 30, 10, 20, 100, 0 };
+    RBTree<int> b{ 45, 55, 25, 15, 30, 10 };
+    for (auto it = std::begin(a); it != std::end(a); ++it)
+        std::cout << *it << " ";
+    std::cout << std::endl;
+    // early termination
+    auto big = std::find_if(std::begin(a), std::end(a), [](int v) { return v > 25; });
+    std::cout << "First above 25: " << *big << std::endl;
+    // lockstep merge, O(n + m)
+    std::vector<int> both;
+    std::set_union(std::begin(a), std::end(a), std::begin(b), std::end(b)
+        , std::back_inserter(both));
+    for (int v : both)
+        std::cout << v << " ";
+    std::cout << std::endl;
+    std::cout << "Lazy stream, take 3: ";
+    forEach(toStream(a).take(3), [](int v)
+    {
+        std::cout << v << " ";
+    });
+    std::cout << std::endl;
+}
+
+void testFlat()
+{
+    RBTree<int> t{ 50, 40, 30, 10, 20, 100, 0 };
+    std::ostringstream os;
+    FlatRBTree<int>::write(t, os);
+    std::string image = os.str();
+    FlatRBTree<int> flat(image.data(), image.size());
+    std::cout << "Flat: " << flat.size() << " nodes, member 30: " << flat.member(30)
+        << ", member 35: " << flat.member(35) << std::endl;
+    MappedRBTree<int> mapped(flat);
+    std::cout << "Thawed before insert: " << mapped.isThawed() << std::endl;
+    auto t1 = mapped.inserted(35);
+    std::cout << "Thawed after insert: " << mapped.isThawed() << std::endl;
+    print(t1);
+    t1.assert1();
+}
+
+template<class Nodes>
+void benchLookup(int n)
+{
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+    RBTree<int, std::less<int>, Nodes> t;
+    for (int k : keys)
+        t = t.inserted(k);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+    auto start = std::chrono::steady_clock::now();
+    int found = 0;
+    for (int k : keys)
+        found += t.member(k);
+    auto end = std::chrono::steady_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << n << " keys, " << RBTree<int, std::less<int>, Nodes>::nodeBytes() << " bytes/node, "
+        << found << " found in " << ms << " ms" << std::endl;
+}
+
+void testBench()
+{
+    std::cout << "Shared nodes\n";
+    benchLookup<SharedNodes>(1000000);
+    std::cout << "Compact nodes\n";
+    benchLookup<CompactNodes>(1000000);
+}
+
+/*
+
+Random lookups in a tree of shuffled keys, g++ -O2 -DNDEBUG
+Shared nodes
+1000000 keys, 64 bytes/node, 1000000 found in 1432 ms
+10000000 keys, 64 bytes/node, 10000000 found in 35239 ms
+Compact nodes
+1000000 keys, 24 bytes/node, 1000000 found in 1297 ms
+10000000 keys, 24 bytes/node, 10000000 found in 24660 ms
+The 10000000 runs take a minute between them: call them by hand.
+
+*/
 
 void main()
 {
     testInit();
+    testIter();
+    testFlat();
+    RBTree<int, std::less<int>, CompactNodes> c{ 5, 3, 8, 1 };
+    print(c);
+    RBTree<std::string, std::less<>> words{ "foo", "bar", "baz" };
+    std::cout << "Member bar: " << words.member("bar") << std::endl;
+    RBTree<int, std::greater<int>> down{ 5, 3, 8, 1 };
+    print(down);
     std::string init =  "a red black tree walks into a bar "
                         "has johnny walker on the rocks "
                         "and quickly rebalances itself."
@@ -39,4 +136,5 @@ void main()
         if (!t.member(c))
             std::cout << "Error: " << c << " not found\n";
     });
+    testBench();
 }
\ No newline at end of file
@@ -57,15 +57,17 @@ struct Constr
     }
     bool isMaxTracks(int trackNo) const { return trackNo == _maxTracks; }
     bool isMaxSlots(int slotNo) const { return slotNo == _maxSlots; }
-    TalkSet clashesWith(Talk t) const
+    TalkSet const & clashesWith(Talk t) const
     {
-        return _clashMap.findWithDefault(TalkSet(), t);
+        TalkSet const * clashes = _clashMap.find(t);
+        return clashes ? *clashes : _noClashes;
     }
 
 private:
     int _maxSlots;
     int _maxTracks;
     RBMap<Talk, TalkSet> _clashMap;
+    TalkSet _noClashes;
 };
 
 struct PartSol
@@ -119,7 +121,7 @@ List<PartSlot> PartSlot::refineSlot(Constr const & constr) const
     _talksForSlot.forEach([this, &constr, &candts](Talk tk)
     {
         TalkList otherTalks = _talksForSlot.removed1(tk);
-        TalkSet clashesWithT = constr.clashesWith(tk);
+        TalkSet const & clashesWithT = constr.clashesWith(tk);
         candts = candts.pushed_front(
             PartSlot(_curTrackNo + 1
             , _talksInSlot.pushed_front(tk)
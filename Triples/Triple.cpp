@@ -21,20 +21,6 @@ Stream<int> intsFrom(int n)
     });
 }
 
-template<class T, class F>
-auto fmap(Stream<T> stm, F f)->Stream<decltype(f(stm.get()))>
-{
-    using U = decltype(f(stm.get()));
-    static_assert(std::is_convertible<F, std::function<U(T)>>::value,
-        "fmap requires a function type U(T)");
-
-    if (stm.isEmpty()) return Stream<U>();
-    return Stream<U>([stm, f]()
-    {
-        return Cell<U>(f(stm.get()), fmap(stm.popped_front(), f));
-    });
-}
-
 template<class T, class F>
 auto fmapv(Stream<T> stm, F f)->Stream<decltype(f())>
 {